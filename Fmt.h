@@ -0,0 +1,140 @@
+/*
+ * Name: Fmt Lib.
+ * Description: Small decimal and string emitters and a bounded decimal parser, used in place
+                of sprintf/atoi to build AT commands and reports and to read numbers out of
+                modem lines. No vfprintf, no copies: an emitter writes at p and returns the
+                new end, never writing at or past end (the place kept for the terminator),
+                so a chain of them truncates like snprintf does.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef FMT_H_
+#define FMT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
+
+
+static inline char *FmtChar(char *p, char *end, char c)
+{
+    if (p < end)
+        *p++ = c;
+
+    return p;
+}
+
+static inline char *FmtStr(char *p, char *end, const char *s)
+{
+    while (*s && p < end)
+        *p++ = *s++;
+
+    return p;
+}
+
+// s in program memory
+static inline char *FmtStrF(char *p, char *end, const char *s)
+{
+    char c;
+
+    while (p < end && (c = pgm_read_byte(s++)))
+        *p++ = c;
+
+    return p;
+}
+
+// Digits by subtraction of the powers of ten, no division call: the AVR has no
+// divide instruction and the libgcc routines cost more than a few subtractions
+static inline char *FmtU8(char *p, char *end, uint8_t v)
+{
+    uint8_t d;
+
+    if (v >= 100)
+    {
+        for (d = '0'; v >= 100; v -= 100)
+            d++;
+        p = FmtChar(p, end, d);
+
+        for (d = '0'; v >= 10; v -= 10)
+            d++;
+        p = FmtChar(p, end, d);
+    } else if (v >= 10)
+    {
+        for (d = '0'; v >= 10; v -= 10)
+            d++;
+        p = FmtChar(p, end, d);
+    }
+
+    return FmtChar(p, end, '0' + v);
+}
+
+static inline char *FmtU16(char *p, char *end, uint16_t v)
+{
+    static const uint16_t power[] PROGMEM = { 10000, 1000, 100, 10 };     // Flash, not .data
+    uint8_t lead = 0;
+    char d;
+
+    if (v < 256)
+        return FmtU8(p, end, v);
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        uint16_t pw = pgm_read_word(&power[i]);
+
+        for (d = '0'; v >= pw; v -= pw)
+            d++;
+
+        if (lead || d != '0')
+        {
+            p = FmtChar(p, end, d);
+            lead = 1;
+        }
+    }
+
+    return FmtChar(p, end, '0' + v);
+}
+
+static inline char *FmtI16(char *p, char *end, int16_t v)
+{
+    if (v < 0)
+    {
+        p = FmtChar(p, end, '-');
+        return FmtU16(p, end, -(uint16_t)v);
+    }
+
+    return FmtU16(p, end, v);
+}
+
+// Decimal number in the first n chars of s (a span of a received line), after blanks.
+// Stops at the first other char, at a terminator or after n chars; saturates at 65535.
+// next, if not NULL, gets the char after the number.
+static inline uint16_t FmtParse(const char *s, uint8_t n, const char **next)
+{
+    uint16_t v = 0;
+
+    while (n && *s == ' ')
+    {
+        s++;
+        n--;
+    }
+
+    while (n && *s >= '0' && *s <= '9')
+    {
+        uint8_t d = *s++ - '0';
+
+        // v * 10 + d > 65535, without a division call
+        v = (v > 6553 || (v == 6553 && d > 5)) ? UINT16_MAX : v * 10 + d;
+        n--;
+    }
+
+    if (next)
+        *next = s;
+
+    return v;
+}
+
+// Decimal number at s, s terminated
+#define FmtNum(s)   FmtParse((s), 255, NULL)
+
+#endif /* FMT_H_ */
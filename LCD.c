@@ -94,14 +94,77 @@ me@avinashgupta.com
 #define CLEAR_RS() (LCD_RS_PORT&=(~(1<<LCD_RS_POS)))
 #define CLEAR_RW() (LCD_RW_PORT&=(~(1<<LCD_RW_POS)))
 
-#ifdef LCD_TYPE_162
-	#define LCD_TYPE_204
+//All pin positions are constants, so with the ports in the lower I/O
+//space the SET/CLEAR macros above compile to single sbi/cbi instructions.
+
+#define LCD_DATA_MASK	(0x0F<<LCD_DATA_POS)
+
+//Nibble placement, resolved at compile time for the data position in
+//config.h. LCD_NIBBLE_xx() places a nibble of c on the data lines,
+//LCD_READ_xx() returns the data lines as the high/low nibble of a byte.
+
+#if LCD_DATA_POS==0
+	#define LCD_NIBBLE_HIGH(c)	((c)>>4)
+	#define LCD_NIBBLE_LOW(c)	((c) & 0x0F)
+	#define LCD_READ_HIGH()		((uint8_t)(LCD_DATA_PIN<<4))
+	#define LCD_READ_LOW()		(LCD_DATA_PIN & 0x0F)
+#elif LCD_DATA_POS==4
+	#define LCD_NIBBLE_HIGH(c)	((c) & 0xF0)
+	#define LCD_NIBBLE_LOW(c)	((c)<<4)
+	#define LCD_READ_HIGH()		(LCD_DATA_PIN & 0xF0)
+	#define LCD_READ_LOW()		(LCD_DATA_PIN>>4)
+#else
+	#define LCD_NIBBLE_HIGH(c)	(((c)>>4)<<LCD_DATA_POS)
+	#define LCD_NIBBLE_LOW(c)	(((c) & 0x0F)<<LCD_DATA_POS)
+	#define LCD_READ_HIGH()		(((LCD_DATA_PIN & LCD_DATA_MASK)>>LCD_DATA_POS)<<4)
+	#define LCD_READ_LOW()		((LCD_DATA_PIN & LCD_DATA_MASK)>>LCD_DATA_POS)
 #endif
 
-#ifdef LCD_TYPE_202
-	#define LCD_TYPE_204
+//Only the data lines change, other pins of the port are kept
+#define LCD_DATA_WRITE(n) (LCD_DATA_PORT=(LCD_DATA_PORT & (~LCD_DATA_MASK))|(n))
+
+
+/***************************************************
+	B U I L D   T I M E   C H E C K S
+***************************************************/
+
+#define _PORT_ID_A 1
+#define _PORT_ID_B 2
+#define _PORT_ID_C 3
+#define _PORT_ID_D 4
+#define PORT_ID(x) _CONCAT(_PORT_ID_,x)
+
+#if LCD_DATA_POS>4
+	#error "LCD_DATA_POS must be 0-4, the data nibble has to fit in one port"
+#endif
+
+#if PORT_ID(LCD_E)==PORT_ID(LCD_DATA) && (LCD_DATA_MASK & (1<<LCD_E_POS))
+	#error "LCD_E overlaps the LCD data lines"
+#endif
+
+#if PORT_ID(LCD_RS)==PORT_ID(LCD_DATA) && (LCD_DATA_MASK & (1<<LCD_RS_POS))
+	#error "LCD_RS overlaps the LCD data lines"
 #endif
 
+#if PORT_ID(LCD_RW)==PORT_ID(LCD_DATA) && (LCD_DATA_MASK & (1<<LCD_RW_POS))
+	#error "LCD_RW overlaps the LCD data lines"
+#endif
+
+#if (defined(LCD_TYPE_162)+defined(LCD_TYPE_202)+defined(LCD_TYPE_204)+defined(LCD_TYPE_164))!=1
+	#error "Select exactly one LCD_TYPE_xxx in config.h"
+#endif
+
+//Every row must fit before the next row starts in DDRAM
+#if LCD_ROW0_ADDR+LCD_COLS>LCD_ROW2_ADDR || LCD_ROW2_ADDR+LCD_COLS>LCD_ROW1_ADDR || LCD_ROW1_ADDR+LCD_COLS>LCD_ROW3_ADDR || LCD_ROW3_ADDR+LCD_COLS>0x68
+	#error "LCD geometry does not match the DDRAM row addresses"
+#endif
+
+/***************************************************/
+
+//Glyph manager state
+static uint8_t __slot_glyph[8];	//Logical glyph held by each CGRAM slot
+static uint8_t __slot_lru[8];	//CGRAM slots, most recently used first
+
 void LCDByte(uint8_t c,uint8_t isdata)
 {
 	//Sends a byte to the LCD in 4bit mode
@@ -111,11 +174,10 @@ void LCDByte(uint8_t c,uint8_t isdata)
 
 	//NOTE: THIS FUNCTION RETURS ONLY WHEN LCD HAS COMPLETED PROCESSING THE COMMAND
 
-	uint8_t hn,ln;			//Nibbles
-	uint8_t temp;
+	uint8_t hn,ln;			//Nibbles, already placed on the data lines
 
-	hn=c>>4;
-	ln=(c & 0x0F);
+	hn=LCD_NIBBLE_HIGH(c);
+	ln=LCD_NIBBLE_LOW(c);
 
 	if(isdata==0)
 		CLEAR_RS();
@@ -128,8 +190,7 @@ void LCDByte(uint8_t c,uint8_t isdata)
 
 	//Send high nibble
 
-	temp=(LCD_DATA_PORT & (~(0X0F<<LCD_DATA_POS)))|((hn<<LCD_DATA_POS));
-	LCD_DATA_PORT=temp;
+	LCD_DATA_WRITE(hn);
 
 	_delay_us(1);			//tEH
 
@@ -142,9 +203,7 @@ void LCDByte(uint8_t c,uint8_t isdata)
 	//Send the lower nibble
 	SET_E();
 
-	temp=(LCD_DATA_PORT & (~(0X0F<<LCD_DATA_POS)))|((ln<<LCD_DATA_POS));
-
-	LCD_DATA_PORT=temp;
+	LCD_DATA_WRITE(ln);
 
 	_delay_us(1);			//tEH
 
@@ -164,7 +223,7 @@ void LCDBusyLoop()
 	uint8_t busy,status=0x00,temp;
 
 	//Change Port to input type because we are reading data
-	LCD_DATA_DDR&=(~(0x0f<<LCD_DATA_POS));
+	LCD_DATA_DDR&=(~LCD_DATA_MASK);
 
 	//change LCD mode
 	SET_RW();		//Read mode
@@ -183,8 +242,7 @@ void LCDBusyLoop()
 		//Wait tDA for data to become available
 		_delay_us(0.5);
 
-		status=(LCD_DATA_PIN>>LCD_DATA_POS);
-		status=status<<4;
+		status=LCD_READ_HIGH();
 
 		_delay_us(0.5);
 
@@ -195,8 +253,7 @@ void LCDBusyLoop()
 		SET_E();
 		_delay_us(0.5);
 
-		temp=(LCD_DATA_PIN>>LCD_DATA_POS);
-		temp&=0x0F;
+		temp=LCD_READ_LOW();
 
 		status=status|temp;
 
@@ -209,8 +266,56 @@ void LCDBusyLoop()
 
 	CLEAR_RW();		//write mode
 	//Change Port to output
-	LCD_DATA_DDR|=(0x0F<<LCD_DATA_POS);
+	LCD_DATA_DDR|=LCD_DATA_MASK;
+
+}
+
+uint8_t LCDRead(uint8_t isdata)
+{
+	//Reads a byte from the LCD in 4bit mode
+	//isdata=1 for data at the address counter (AC is incremented)
+	//isdata=0 for status (busy flag and address counter)
+
+	uint8_t val;
+
+	//Change Port to input type because we are reading data
+	LCD_DATA_DDR&=(~LCD_DATA_MASK);
+
+	SET_RW();		//Read mode
+
+	if(isdata==0)
+		CLEAR_RS();
+	else
+		SET_RS();
+
+	_delay_us(0.5);		//tAS
+
+	SET_E();
+	_delay_us(0.5);		//tDA
+
+	val=LCD_READ_HIGH();
+
+	_delay_us(0.5);
+	CLEAR_E();
+	_delay_us(1);	//tEL
+
+	SET_E();
+	_delay_us(0.5);
+
+	val|=LCD_READ_LOW();
+
+	_delay_us(0.5);
+	CLEAR_E();
+	_delay_us(1);	//tEL
+
+	CLEAR_RW();		//write mode
+	//Change Port to output
+	LCD_DATA_DDR|=LCD_DATA_MASK;
+
+	if(isdata)
+		LCDBusyLoop();
 
+	return val;
 }
 
 void LCDInit(uint8_t style)
@@ -231,14 +336,14 @@ void LCDInit(uint8_t style)
 	_delay_ms(100);
 	
 	//Clear Ports
-	LCD_DATA_PORT&=(~(0x0F<<LCD_DATA_POS));
+	LCD_DATA_PORT&=(~LCD_DATA_MASK);
 	
 	CLEAR_E();
 	CLEAR_RW();
 	CLEAR_RS();
 	
 	//Set IO Ports direction
-	LCD_DATA_DDR|=(0x0F<<LCD_DATA_POS);	//data line direction
+	LCD_DATA_DDR|=LCD_DATA_MASK;	//data line direction
 	LCD_E_DDR|=(1<<LCD_E_POS);			//E line line direction
 	LCD_RS_DDR|=(1<<LCD_RS_POS);		//RS line direction
 	LCD_RW_DDR|=(1<<LCD_RW_POS);		//RW line direction
@@ -296,8 +401,15 @@ void LCDInit(uint8_t style)
 	LCDCmd(0b01000000);
 
 	uint8_t __i;
-	for(__i=0;__i<sizeof(__cgram);__i++)
-		LCDData(__cgram[__i]);
+	for(__i=0;__i<64;__i++)
+		LCDData(pgm_read_byte(&__cgram[__i]));
+
+	//Glyphs 0-7 are now resident in slots 0-7
+	for(__i=0;__i<8;__i++)
+	{
+		__slot_glyph[__i]=__i;
+		__slot_lru[__i]=__i;
+	}
 	
 	LCDClear();
 
@@ -330,6 +442,9 @@ void LCDWriteString(const char *msg)
 		
 	In the same way you can insert any syblom numbered 0-7 	
 
+	%n prints logical glyph n through the glyph manager, so it is
+	still correct after slot n has been reused by LCDWriteGlyph().
+
 
 	*****************************************************************/
  while(*msg!='\0')
@@ -342,7 +457,7 @@ void LCDWriteString(const char *msg)
 
 		if(cc>=0 && cc<=7)
 		{
-			LCDData(cc);
+			LCDWriteGlyph(cc);
 		}
 		else
 		{
@@ -386,6 +501,9 @@ void LCDWriteFString(const char *msg)
 		
 	In the same way you can insert any syblom numbered 0-7 	
 
+	%n prints logical glyph n through the glyph manager, so it is
+	still correct after slot n has been reused by LCDWriteGlyph().
+
 
 	*****************************************************************/
 	
@@ -403,7 +521,7 @@ void LCDWriteFString(const char *msg)
 
 		if(cc>=0 && cc<=7)
 		{
-			LCDData(cc);
+			LCDWriteGlyph(cc);
 		}
 		else
 		{
@@ -420,6 +538,18 @@ void LCDWriteFString(const char *msg)
  }
 }
 
+void LCDWriteFRaw(const char *msg)
+{
+	//Writes a flash string as is, '%' has no special meaning. Used by
+	//LCD_F/LCD_FP, which take glyphs as LCD_G() items, so one source
+	//char is one cell and the pad can be computed from sizeof.
+
+	char ch;
+
+	while((ch=pgm_read_byte(msg++))!='\0')
+		LCDData(ch);
+}
+
 void LCDWriteInt(int val,int8_t field_length)
 {
 	/***************************************************************
@@ -466,45 +596,136 @@ void LCDWriteInt(int val,int8_t field_length)
 }
 void LCDGotoXY(uint8_t x,uint8_t y)
 {
- 	if(x>=20) return;
+	if(x>=LCD_COLS || y>=LCD_ROWS) return;
 
-	#ifdef LCD_TYPE_204
-	
+	//Row start addresses are constants from LCD.h, checked above
 	switch(y)
 	{
 		case 0:
+			x+=LCD_ROW0_ADDR;
 			break;
 		case 1:
-			x|=0b01000000;
+			x+=LCD_ROW1_ADDR;
 			break;
 		case 2:
-			x+=0x14;
+			x+=LCD_ROW2_ADDR;
 			break;
 		case 3:
-			x+=0x54;
+			x+=LCD_ROW3_ADDR;
 			break;
 	}
 
-	#endif
+	x|=0b10000000;
+  	LCDCmd(x);
+}
 
-	#ifdef LCD_TYPE_164
-	switch(y)
+static void LCDGlyphTouch(uint8_t slot)
+{
+	//Moves slot to the front of the LRU list
+
+	uint8_t i=0;
+
+	while(__slot_lru[i]!=slot) i++;
+
+	for(;i>0;i--)
+		__slot_lru[i]=__slot_lru[i-1];
+
+	__slot_lru[0]=slot;
+}
+
+static void LCDGlyphEvict(uint8_t slot)
+{
+	//Every cell still showing slot is rewritten with the plain
+	//character of the glyph that is leaving it. DDRAM is read back
+	//so cells overwritten since the glyph was drawn are left alone.
+
+	char alt=pgm_read_byte(&__cgram_alt[__slot_glyph[slot]]);
+	uint8_t x,y,c;
+
+	for(y=0;y<LCD_ROWS;y++)
 	{
-		case 0:
-			break;
-		case 1:
-			x|=0b01000000;
-			break;
-		case 2:
-			x+=0x10;
-			break;
-		case 3:
-			x+=0x50;
-			break;
+		LCDGotoXY(0,y);
+
+		for(x=0;x<LCD_COLS;x++)
+		{
+			c=LCDRead(1);
+
+			//Codes 8-15 are aliases of CGRAM slots 0-7
+			if((c & 0xF0)==0 && (c & 0x07)==slot)
+			{
+				LCDGotoXY(x,y);
+				LCDData(alt);
+
+				//A read is only valid after an address set, not after a write
+				if(x+1<LCD_COLS) LCDGotoXY(x+1,y);
+			}
+		}
 	}
+}
 
-	#endif
+uint8_t LCDGlyphSlot(uint8_t glyph)
+{
+	/*****************************************************************
 
-	x|=0b10000000;
-  	LCDCmd(x);
-}
\ No newline at end of file
+	This function makes a logical glyph resident in CGRAM and returns
+	the character code (slot 0-7) that displays it.
+
+	Arguments:
+	glyph: LCD_GLYPH_xxx number, see LCD.h
+
+	The glyph set in custom_char.h is larger than the 8 CGRAM slots.
+	A glyph is uploaded only when it is not already resident, the
+	least recently used slot is reused and the cells showing the old
+	glyph are replaced by its plain character (see __cgram_alt).
+	The cursor position is kept.
+
+	*****************************************************************/
+
+	uint8_t slot,addr,i;
+	const unsigned char *bits;
+
+	for(slot=0;slot<8;slot++)
+	{
+		if(__slot_glyph[slot]==glyph)
+		{
+			LCDGlyphTouch(slot);
+			return slot;
+		}
+	}
+
+	if(glyph>=LCD_GLYPH_COUNT)
+		return '?';
+
+	slot=__slot_lru[7];
+
+	//Save cursor, it is moved by the scan and by the CGRAM upload
+	addr=LCDRead(0) & 0x7F;
+
+	LCDGlyphEvict(slot);
+
+	LCDCmd(0b01000000|(slot<<3));
+
+	bits=&__cgram[(uint16_t)glyph<<3];
+	for(i=0;i<8;i++)
+		LCDData(pgm_read_byte(bits+i));
+
+	__slot_glyph[slot]=glyph;
+	LCDGlyphTouch(slot);
+
+	LCDCmd(0b10000000|addr);
+
+	return slot;
+}
+
+void LCDWriteGlyph(uint8_t glyph)
+{
+	//Writes a logical glyph at the current cursor location
+	LCDData(LCDGlyphSlot(glyph));
+}
+
+void LCDPad(int8_t n)
+{
+	//Writes n blanks, used by LCDPrint() to fill a field
+	while(n-- > 0)
+		LCDData(' ');
+}
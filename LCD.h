@@ -59,6 +59,7 @@ me@avinashgupta.com
 *******************************************************************************/
 
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 
 #ifndef _LCD_H
 #define _LCD_H
@@ -76,6 +77,54 @@ me@avinashgupta.com
 #define LS_NONE	 0B00000000
 
 
+//Display geometry, derived from the LCD_TYPE_xxx selection in config.h
+
+#if defined(LCD_TYPE_202) || defined(LCD_TYPE_204)
+	#define LCD_COLS 20
+#else
+	#define LCD_COLS 16
+#endif
+
+#if defined(LCD_TYPE_204) || defined(LCD_TYPE_164)
+	#define LCD_ROWS 4
+#else
+	#define LCD_ROWS 2
+#endif
+
+//DDRAM address of the first char of each row, used by LCDGotoXY()
+
+#define LCD_ROW0_ADDR	0x00
+#define LCD_ROW1_ADDR	0x40
+
+#ifdef LCD_TYPE_164
+	#define LCD_ROW2_ADDR	0x10
+	#define LCD_ROW3_ADDR	0x50
+#else
+	#define LCD_ROW2_ADDR	0x14
+	#define LCD_ROW3_ADDR	0x54
+#endif
+
+
+//Logical glyph numbers, index into the glyph set of custom_char.h
+
+#define LCD_GLYPH_SMALL_DOT		0
+#define LCD_GLYPH_BIG_DOT		1
+#define LCD_GLYPH_DOWN_ARROW	2
+#define LCD_GLYPH_HEART_FILLED	3
+#define LCD_GLYPH_HEART_EMPTY	4
+#define LCD_GLYPH_DEGREE		5
+#define LCD_GLYPH_UP_ARROW		6
+#define LCD_GLYPH_TICK			7
+#define LCD_GLYPH_SIGNAL_0		8	//SIGNAL_0+n shows n bars, n=0..4
+#define LCD_GLYPH_BATTERY_EMPTY	13
+#define LCD_GLYPH_BATTERY_HALF	14
+#define LCD_GLYPH_BATTERY_FULL	15
+#define LCD_GLYPH_VALVE_OPEN	16
+#define LCD_GLYPH_VALVE_CLOSED	17
+
+#define LCD_GLYPH_COUNT			18
+
+
 
 /***************************************************
 			F U N C T I O N S
@@ -87,12 +136,20 @@ void LCDInit(uint8_t style);
 
 void LCDWriteString(const char *msg);
 void LCDWriteFString(const char *msg);
+void LCDWriteFRaw(const char *msg);
 
 void LCDWriteInt(int val,int8_t field_length);
 void LCDGotoXY(uint8_t x,uint8_t y);
 
+//Glyph manager
+uint8_t LCDGlyphSlot(uint8_t glyph);
+void LCDWriteGlyph(uint8_t glyph);
+
+void LCDPad(int8_t n);
+
 //Low level
 void LCDByte(uint8_t,uint8_t);
+uint8_t LCDRead(uint8_t isdata);
 #define LCDCmd(c) (LCDByte(c,0))
 #define LCDData(d) (LCDByte(d,1))
 
@@ -109,6 +166,7 @@ void LCDBusyLoop();
 ***************************************************/
 #define LCDClear() LCDCmd(0b00000001)
 #define LCDHome() LCDCmd(0b00000010);
+#define LCDCursor(style) LCDCmd(0b00001100|(style))	//Display on, cursor style LS_xxx, LS_NONE hides it
 
 #define LCDWriteStringXY(x,y,msg) {\
  LCDGotoXY(x,y);\
@@ -124,6 +182,50 @@ LCDWriteFString(msg);\
  LCDGotoXY(x,y);\
  LCDWriteInt(val,fl);\
 }
+
+#define LCDWriteGlyphXY(x,y,g) {\
+ LCDGotoXY(x,y);\
+ LCDWriteGlyph(g);\
+}
+
+
+/***************************************************
+	F O R M A T T E D   O U T P U T
+
+The format is given as a list of items which the
+preprocessor turns into a sequence of emit calls,
+nothing is parsed at run time:
+
+	LCDPrintXY(0,1,LCD_FP("Ref",6),LCD_I(ref,3),LCD_G(LCD_GLYPH_TICK));
+
+LCD_S(s)	RAM string, %0-%7 escapes as in LCDWriteString
+LCD_F(s)	string literal kept in flash, no escapes
+LCD_FP(s,w)	flash literal padded with blanks to w chars,
+			the pad is computed at compile time
+LCD_I(v,w)	int in a field of w digits (1-5, -1 for no padding)
+LCD_G(g)	logical glyph LCD_GLYPH_xxx, replaces the %n escape
+LCD_C(c)	single character
+
+Literals given to LCD_F/LCD_FP are printed as is through
+LCDWriteFRaw(), "%1" is two chars, use LCD_G() for glyphs.
+Widths are checked by the compiler.
+***************************************************/
+
+#define LCD_CHECK(cond)	((void)sizeof(char[(cond)?1:-1]))
+
+#define LCD_S(s)		LCDWriteString(s)
+#define LCD_F(s)		LCDWriteFRaw(PSTR(s))
+#define LCD_FP(s,w)		(LCD_CHECK((w)>=sizeof(s)-1),LCDWriteFRaw(PSTR(s)),LCDPad((w)-(sizeof(s)-1)))
+#define LCD_I(v,w)		(LCD_CHECK(((w)>=1 && (w)<=5) || (w)==-1),LCDWriteInt(v,w))
+#define LCD_G(g)		LCDWriteGlyph(g)
+#define LCD_C(c)		LCDData(c)
+
+#define LCDPrint(...)	((void)(__VA_ARGS__))
+
+#define LCDPrintXY(x,y,...) {\
+ LCDGotoXY(x,y);\
+ LCDPrint(__VA_ARGS__);\
+}
 /***************************************************/
 
 
@@ -11,404 +11,2789 @@
 
 
 #include <avr/io.h>
+#include <avr/wdt.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
 #include <string.h>
 
 #include "Gen_Def.h"
-#include "UART_4.h"
+#include "config.h"
+#include "UART.h"
 #include "LCD.h"
+#include "Tick.h"
 
 #include "SIM900.h"
+#include "SIM900Trace.h"
+#include "SIM900Stats.h"
+#include "SIM900Match.h"
+#include "Fmt.h"
 
 
+#define SIM900_CMD_TIMEOUT  1000    // Time (ms) the module gets to answer a command
+#define SIM900_SEND_TIMEOUT 6000    // Time (ms) the module gets to send a message
+#define SIM900_LIST_TIMEOUT 20000   // Time (ms) the module gets to list or purge the storage
+
+#define SIM900_CMD_HEAD     8       // Leading chars of a command SIM900CmdClass looks at
+#define SIM900_MSG_LEN      127     // Body chars SIM900ReadMsg copies out
+
+typedef struct
+{
+    char    *p;         // Where the next chunk goes
+    uint8_t room;       // Chars left
+} SIM900BodyCopy;
+
+#define SIM900_PROBE_TIME   100     // Time (ms) between the AT probes of a module that may be on
+#define SIM900_PROBE_TRIES  3       // Probes before the module is taken as off
+#define SIM900_PWRKEY_TIME  1200    // PWRKEY low time (ms) to switch the module on, at least 1 s
+#define SIM900_SYNC_TIME    500     // Time (ms) between the AT sent to lock the module's autobaud
+#define SIM900_BOOT_TIMEOUT 20000   // Time (ms) from power on to Call Ready
+#define SIM900_OFF_TIME     3000    // Time (ms) a module switched off by the supervisor stays off
+#define SIM900_LINE_TIME    20      // Time (ms) to complete a line that has started arriving
+#define SIM900_GPRS_TIMEOUT 60000   // Time (ms) the module gets to bring the GPRS bearer up
+#define SIM900_TCP_TIMEOUT  30000   // Time (ms) the module gets to connect
+#define SIM900_TCP_SEND_TIMEOUT 10000   // Time (ms) from the data to SEND OK
+
+#define _CONCAT(a,b) a##b
+#define PORT(x) _CONCAT(PORT,x)
+#define DDR(x) _CONCAT(DDR,x)
+
+#if SIM900_PWRKEY_INVERT
+    #define SIM900_PWRKEY_PRESS()   (PORT(SIM900_PWRKEY) |= (1<<SIM900_PWRKEY_POS))
+    #define SIM900_PWRKEY_RELEASE() (PORT(SIM900_PWRKEY) &= ~(1<<SIM900_PWRKEY_POS))
+#else
+    #define SIM900_PWRKEY_PRESS()   (PORT(SIM900_PWRKEY) &= ~(1<<SIM900_PWRKEY_POS))
+    #define SIM900_PWRKEY_RELEASE() (PORT(SIM900_PWRKEY) |= (1<<SIM900_PWRKEY_POS))
+#endif
+
+// Boot steps
+#define SIM900_BOOT_IDLE    0
+#define SIM900_BOOT_PROBE   1       // Checking if the module is already on
+#define SIM900_BOOT_PWRKEY  2       // PWRKEY held low
+#define SIM900_BOOT_WAIT    3       // Waiting for the readiness URCs
+#define SIM900_BOOT_OFF     4       // Power cycle: PWRKEY held to switch off, then off for a while
+
 char SIM900_buffer[128];    // A common buffer used to read response from SIM900
 
+static uint8_t SIM900_held;         // Length of a line read too early and kept for the next read
+static uint8_t SIM900_line;         // SIM900_LINE_xxx of the line in SIM900_buffer
+static uint8_t SIM900_creg;         // Last <stat> reported by +CREG
+static uint8_t SIM900_echo = TRUE;  // FALSE once the module is known to run with ATE0
+
+// RTS/CTS flow control in both directions when the port is wired for it
+#if SIM900_FLOW
+    #define SIM900_PROFILE_IFC      ";+IFC=2,2"
+    #define SIM900_PROFILE_IFC_Q    ";+IFC?"
+    #define SIM900_PROFILE_IFC_ANS  , "+IFC: 2,2"
+#else
+    #define SIM900_PROFILE_IFC
+    #define SIM900_PROFILE_IFC_Q
+    #define SIM900_PROFILE_IFC_ANS
+#endif
+
+// Module profile: no echo, text mode SMS, +CMTI for new messages and +CDS for status
+// reports, numeric errors, GSM character set, status reports requested (first octet 49:
+// SMS-SUBMIT, relative validity, SRR), flow control. Applied in one command line and
+// stored with AT&W. All of it stays in flash.
+static const char SIM900_profile_set[] PROGMEM   = "ATE0+CMGF=1;+CNMI=2,1,0,1,0;+CMEE=1;+CSCS=\"GSM\";+CSMP=49,167,0,0"
+                                                   SIM900_PROFILE_IFC;
+static const char SIM900_profile_query[] PROGMEM = "AT+CMGF?;+CNMI?;+CMEE?;+CSCS?;+CSMP?" SIM900_PROFILE_IFC_Q;
+static const char SIM900_profile_ans[][18] PROGMEM = { "+CMGF: 1", "+CNMI: 2,1,0,1,0", "+CMEE: 1", "+CSCS: \"GSM\"",
+                                                       "+CSMP: 49,167,0,0" SIM900_PROFILE_IFC_ANS };
+
+#define SIM900_PROFILE_LINES    (sizeof(SIM900_profile_ans) / sizeof(SIM900_profile_ans[0]))
+
+static uint8_t  SIM900_boot;        // SIM900_BOOT_xxx
+static uint8_t  SIM900_boot_n;      // Probes sent in the current step
+static uint16_t SIM900_boot_start;  // Tick of SIM900BootStart
+static uint16_t SIM900_boot_step;   // Tick of the last step or probe
+static uint8_t  SIM900_ready;       // SIM900_READY_xxx flags seen
+static uint16_t SIM900_ready_at[4]; // Ticks from SIM900BootStart to each readiness URC
+
+#define SIM900_CMTI_QUEUE   4       // Incoming message notifications kept until SIM900WaitForMsg
+
+static uint8_t SIM900_cmti[SIM900_CMTI_QUEUE];  // Slots announced by +CMTI
+static uint8_t SIM900_cmti_head;
+static uint8_t SIM900_cmti_count;
+
+#if SIM900_STORE_MAX % 8 || SIM900_STORE_MAX > 248
+    #error "SIM900_STORE_MAX must be a multiple of 8 up to 248"
+#endif
+
+static uint8_t SIM900_store[SIM900_STORE_MAX / 8];  // Occupied slots, bit n-1 for slot n
+static uint8_t SIM900_store_used;   // Bits set
+static uint8_t SIM900_store_total;  // Slots of the selected memory, 0: not known yet
+static uint8_t SIM900_store_me;     // TRUE: "ME" selected, FALSE: "SM"
+static uint8_t SIM900_store_limit;  // Occupancy that triggers the next purge
+
+#if SIM900_DUP_SETS & (SIM900_DUP_SETS - 1)
+    #error "SIM900_DUP_SETS must be a power of two"
+#endif
+
+// Recently read messages, 2-way sets picked by the low bits of the hash. 0 is a free entry.
+static uint32_t SIM900_dup[SIM900_DUP_SETS][2];
+static uint8_t  SIM900_dup_old[SIM900_DUP_SETS / 8 + 1];   // Per set, the entry replaced next
+
+static uint8_t  SIM900_heard;        // A line came in since the last liveness check
+static uint16_t SIM900_live_at;      // Seconds (SIM900Clock) the module last proved alive
+static uint8_t  SIM900_live_step;    // SIM900_LIVE_xxx taken last, SIM900_LIVE_OK when healthy
+static uint8_t  SIM900_live_count[3];// Recovery steps taken, per SIM900_LIVE_xxx
+
+static uint8_t SIM900_gprs;         // GPRS bearer up (AT+CIICR done), cleared by +PDP: DEACT
+static uint8_t SIM900_tcp;          // SIM900_TCP_xxx
+
+#define SIM900_CSQ_UNKNOWN  99      // <rssi>/<ber> value for "not known"
+
+static uint16_t SIM900_csq_period = SIM900_CSQ_PERIOD;  // Seconds between AT+CSQ samples
+static uint16_t SIM900_csq_secs;                        // Seconds since the last sample
+static uint16_t SIM900_csq_tick;                        // Start of the current second
+static uint8_t  SIM900_csq_avg = 0xFF;                  // Smoothed <rssi> x 16, 0xFF: no sample yet
+static SIM900Signal SIM900_signal = { SIM900_CSQ_UNKNOWN, SIM900_CSQ_UNKNOWN,
+                                      SIM900_CSQ_UNKNOWN, SIM900_CSQ_UNKNOWN, 0 };
+
+#if SIM900_DLR_SLOTS & (SIM900_DLR_SLOTS - 1)
+    #error "SIM900_DLR_SLOTS must be a power of two"
+#endif
+
+typedef struct
+{
+    uint16_t    first;      // First code, SIM900_ERR_CME for +CME ERROR codes
+    uint8_t     count;      // Codes in the range
+    uint8_t     cls;        // SIM900_ERR_xxx
+} SIM900ErrRange;
+
+// Error codes of 3GPP TS 27.005 (+CMS, with the TS 24.011 and TP-FCS causes below 256)
+// and TS 27.007 (+CME), ascending and not overlapping. Codes not listed are SIM900_ERR_LATER.
+static const SIM900ErrRange SIM900_err_table[] PROGMEM =
+{
+    { 1,   1,  SIM900_ERR_FATAL },      // Unassigned number
+    { 8,   1,  SIM900_ERR_FATAL },      // Operator determined barring
+    { 10,  1,  SIM900_ERR_FATAL },      // Call barred
+    { 21,  1,  SIM900_ERR_FATAL },      // Short message transfer rejected
+    { 28,  3,  SIM900_ERR_FATAL },      // Unidentified, facility rejected, unknown subscriber
+    { 41,  1,  SIM900_ERR_RETRY },      // Temporary failure
+    { 50,  1,  SIM900_ERR_FATAL },      // Facility not subscribed
+    { 69,  1,  SIM900_ERR_FATAL },      // Facility not implemented
+    { 81,  1,  SIM900_ERR_RETRY },      // Invalid short message reference
+    { 95,  5,  SIM900_ERR_FATAL },      // Invalid or unknown message contents
+    { 111, 1,  SIM900_ERR_RETRY },      // Protocol error
+    { 128, 64, SIM900_ERR_FATAL },      // TP-PID, TP-DCS and command errors
+    { 193, 1,  SIM900_ERR_FATAL },      // No SC subscription
+    { 195, 13, SIM900_ERR_FATAL },      // Invalid SME address, SME barred, duplicate rejected
+    { 209, 1,  SIM900_ERR_FATAL },      // No SMS storage on the SIM
+    { 210, 1,  SIM900_ERR_RETRY },      // Error in MS
+    { 213, 42, SIM900_ERR_FATAL },
+    { 255, 1,  SIM900_ERR_RETRY },      // Unspecified
+    { 301, 5,  SIM900_ERR_FATAL },      // Service reserved, not allowed, not supported, bad parameter
+    { 310, 4,  SIM900_ERR_SIM },        // SIM not inserted, PIN, PH-SIM PIN, SIM failure
+    { 315, 4,  SIM900_ERR_SIM },        // SIM wrong, PUK, PIN2, PUK2
+    { 320, 2,  SIM900_ERR_FATAL },      // Memory failure, invalid index
+    { 330, 1,  SIM900_ERR_FATAL },      // SMSC address unknown
+    { 332, 1,  SIM900_ERR_RETRY },      // Network timeout
+    { 340, 1,  SIM900_ERR_FATAL },      // No +CNMA expected
+    { 500, 1,  SIM900_ERR_RETRY },      // Unknown error
+    { 517, 1,  SIM900_ERR_SIM },        // SIM not ready
+    { SIM900_ERR_CME + 3,   2, SIM900_ERR_FATAL },  // Not allowed, not supported
+    { SIM900_ERR_CME + 10,  4, SIM900_ERR_SIM },    // SIM not inserted, PIN, PUK, SIM failure
+    { SIM900_ERR_CME + 15,  1, SIM900_ERR_SIM },    // SIM wrong
+    { SIM900_ERR_CME + 16,  1, SIM900_ERR_FATAL },  // Incorrect password
+    { SIM900_ERR_CME + 17,  2, SIM900_ERR_SIM },    // PIN2, PUK2
+    { SIM900_ERR_CME + 21,  7, SIM900_ERR_FATAL },  // Invalid index, not found, memory failure, text
+    { SIM900_ERR_CME + 31,  1, SIM900_ERR_RETRY },  // Network timeout
+    { SIM900_ERR_CME + 40,  9, SIM900_ERR_SIM },    // Personalisation PINs
+    { SIM900_ERR_CME + 100, 1, SIM900_ERR_RETRY },  // Unknown
+};
+
+#define SIM900_ERR_RANGES   (sizeof(SIM900_err_table) / sizeof(SIM900_err_table[0]))
+
+static uint16_t SIM900_err_code;    // Code of the last error result, SIM900_ERR_CME, SIM900_ERR_PLAIN
+static uint8_t  SIM900_err_cls;     // SIM900_ERR_xxx of the last command
+static uint8_t  SIM900_sim_errs;    // SIM errors since a SIM command last succeeded
+static uint8_t  SIM900_sim_reset;   // The supervisor restarted the module for them
+
+static SIM900Delivery SIM900_dlr[SIM900_DLR_SLOTS];    // Sent messages, slot <mr> % SIM900_DLR_SLOTS
+static SIM900DeliveryStats SIM900_dlr_stats;
+
+static uint16_t SIM900_secs;        // Seconds since power on (SIM900Clock)
+static uint16_t SIM900_secs_tick;   // Start of the current second
+
 
 /**
- * Name: SIM900Init
- * Description: The funtion initializes the SIM900 module by sending
- *              "AT" command, get the response and check it out to see if module works fine
+ * Name: SIM900CmdClass
+ * Description: The function finds the class of a command for trace and statistics.
  * @Author: Mehdi
  *
- * @Return	Messages indicates if the module works fine (SIM900_OK) or not (SIM900_TIMEOUT)
+ * @Params	cmd: The command, ex "AT+CMGR=3"
+ * @Return  SIM900_CMD_xxx
 */
 
-int8_t SIM900Init()
+static uint8_t SIM900CmdClass(const char *cmd)
 {
-    SIM900Cmd("AT");    // Test command
+    if (strncasecmp_P(cmd,PSTR("AT+C"),4) != 0)
+        return (cmd[2] == '\0') ? SIM900_CMD_AT : SIM900_CMD_OTHER;
+
+    cmd += 4;
+
+    if (strncasecmp_P(cmd,PSTR("REG"),3) == 0) return SIM900_CMD_CREG;
+    if (strncasecmp_P(cmd,PSTR("SQ"),2) == 0)  return SIM900_CMD_CSQ;
+    if (strncasecmp_P(cmd,PSTR("IP"),2) == 0)  return SIM900_CMD_CIP;
+    if (strncasecmp_P(cmd,PSTR("STT"),3) == 0 || strncasecmp_P(cmd,PSTR("IICR"),4) == 0 || strncasecmp_P(cmd,PSTR("IFSR"),4) == 0)
+        return SIM900_CMD_CIP;
+    if (strncasecmp_P(cmd,PSTR("MGR"),3) == 0) return SIM900_CMD_CMGR;
+    if (strncasecmp_P(cmd,PSTR("MGDA"),4) == 0) return SIM900_CMD_OTHER;   // Purge, not a single delete
+    if (strncasecmp_P(cmd,PSTR("MGD"),3) == 0) return SIM900_CMD_CMGD;
+    if (strncasecmp_P(cmd,PSTR("MGS"),3) == 0) return SIM900_CMD_CMGS;
+
+    return SIM900_CMD_OTHER;
+}
 
-    uint16_t i = 0;
 
-    while(i < 10)
-    {
-        if (USART_DataAvailable() == FALSE)
-        {
-            i++;
-            _delay_ms(10);
-        } else
-        {
-            // We got a response that is 6 bytes long
-			// Now check it
-            SIM900_buffer = USART_Receive_String_ISR(); // Read serial Data
+/**
+ * Name: SIM900Result
+ * Description: The function ends an exchange: it logs the return code and the latency
+ *              in the trace and the statistics, then hands the code back.
+ * @Author: Mehdi
+ *
+ * @Params	code: Return code of the exchange
+ * @Return  code
+*/
 
-            return SIM900CheckResponse(SIM900_buffer,"OK",6);
-        }
+static int8_t SIM900Result(int8_t code)
+{
+    uint16_t ticks = TickNow() - SIM900_trace_start;
+
+    SIM900TraceResult(code, ticks);
+    SIM900StatsResult(SIM900_trace_cmd, code, ticks);
 
+    // A ping proves the module, not the SIM
+    if (code == SIM900_OK && SIM900_trace_cmd != SIM900_CMD_AT)
+    {
+        SIM900_sim_errs = 0;
+        SIM900_sim_reset = FALSE;
     }
 
-    return SIM900_TIMEOUT;
+    return code;
 }
 
 
 /**
- * Name: SIM900Cmd
- * Description: The function send the given command to the module and
- *              check if the module recieves any feedback from module
+ * Name: SIM900ErrorClass
+ * Description: The function looks the class of an error code up in the flash table.
  * @Author: Mehdi
  *
- * @Params	cmd: The command wanted to send to module
- * @Return	Messages indicates if the module works fine (SIM900_OK) or not (SIM900_TIMEOUT)
+ * @Params	code: +CMS ERROR code, or +CME ERROR code with SIM900_ERR_CME, or SIM900_ERR_PLAIN
+ * @Return  SIM900_ERR_xxx
 */
 
-int8_t SIM900Cmd(const char *cmd)
+uint8_t SIM900ErrorClass(uint16_t code)
 {
-    USART_Transmit_String(cmd); // Send Command
-    USART_Transmit_char(0x0D);  // CR
-
-    uint8_t len = strlen(cmd);  
-
-    len++;	// Add 1 for trailing CR added to all commands
-
-    uint16_t i = 0;
-
-    while (i < 10 * len)
+    for (uint8_t i = 0; i < SIM900_ERR_RANGES; i++)
     {
-        if(USART_DataAvailable() == FALSE)
-        {
-            i++;
-            _delay_ms(10);
-        } else
-        {
-            SIM900_buffer = USART_Receive_String_ISR();
+        uint16_t first = pgm_read_word(&SIM900_err_table[i].first);
 
-            return SIM900_OK;
-        }
+        if (code < first)
+            break;      // Ascending, nothing further can hold it
+
+        if (code - first < pgm_read_byte(&SIM900_err_table[i].count))
+            return pgm_read_byte(&SIM900_err_table[i].cls);
     }
 
-    return SIM900_TIMEOUT;
+    return SIM900_ERR_LATER;
 }
 
 
 /**
- * Name: SIM900CheckResponse
- * Description: The function check the response received from module
- *              and return back appropriate feedback.
+ * Name: SIM900LastError
+ * Description: The function returns the error the last command ended with, so a caller
+ *              can tell an error worth repeating from one that will never succeed.
  * @Author: Mehdi
  *
- * @Params	response: the response get from module and check by the function
- * @Params  check: the word with witch "response" is compared
- * @Params  len: length of "response" should be compare with "check"
- * @Return  SIM900_INVALID_RESPONSE: if two first or two last char of response are not "\n"
- * @Return  SIM900_FAIL: if "response" does not match "check"
+ * @Params	code (Out): Error code as for SIM900ErrorClass, may be NULL
+ * @Return  SIM900_ERR_xxx, SIM900_ERR_NONE if the command got no error result
 */
 
-int8_t SIM900CheckResponse(const char *response, const char *check, uint8_t len)
+uint8_t SIM900LastError(uint16_t *code)
 {
-    len -= 2;
+    if (code)
+        *code = SIM900_err_code;
 
-    // Check leading CR LF
-    if (response[0] != 0x0D | response[1] != 0x0A)
-        return SIM900_INVALID_RESPONSE;
+    return SIM900_err_cls;
+}
 
-    // Check leading CR LF
-    if (response[len] != 0x0D | response[len+1] != 0x0A)
-        return SIM900_INVALID_RESPONSE;
 
-    for (uint8_t i = 2; i < len; i++)
+/**
+ * Name: SIM900LineError
+ * Description: The function takes the code of an error result in SIM900_buffer and
+ *              classifies it for the caller, the statistics and the supervisor.
+ * @Author: Mehdi
+*/
+
+static void SIM900LineError(void)
+{
+    switch (SIM900_line)
     {
-        if(response[i] != check[i-2])
-            return SIM900_FAIL;
+    case SIM900_LINE_CMS:
+        SIM900_err_code = FmtNum(SIM900_buffer + 11);
+        break;
+
+    case SIM900_LINE_CME:
+        SIM900_err_code = SIM900_ERR_CME | FmtNum(SIM900_buffer + 11);
+        break;
+
+    case SIM900_LINE_ERROR:
+        SIM900_err_code = SIM900_ERR_PLAIN;
+        break;
+
+    default:
+        return;
     }
 
-    return SIM900_OK;
+    SIM900_err_cls = SIM900ErrorClass(SIM900_err_code);
+    SIM900StatsError(SIM900_err_cls);
+
+    if (SIM900_err_cls == SIM900_ERR_SIM && SIM900_sim_errs < 255)
+        SIM900_sim_errs++;
 }
 
 
+
+
 /**
- * Name: SIM900WaitForResponse
- * Description: The function add a given delay to receive response from module,
- *              and if receives any response, return number of char response
+ * Name: SIM900ReadLine
+ * Description: The function reads the next line sent by the module into SIM900_buffer.
+ *              Empty lines (the CR LF framing of the responses) are skipped, the line is
+ *              stored without CR LF and terminated. Its bytes go through the matcher as they
+ *              arrive, the class is left in SIM900_line.
  * @Author: Mehdi
  *
- * @Params	timeout: the amount of time (milisec) uC waits
- * @Return  Number of char of response
+ * @Params	ticks: the time uC waits for a complete line
+ * @Return  Length of the line, 0 on timeout
 */
 
-int8_t SIM900WaitForResponse(uint16_t timeout)
+static uint8_t SIM900ReadLine(uint16_t ticks)
 {
+    uint16_t start = TickNow();
     uint8_t i = 0;
-    uint16_t n = 0;
+    SIM900Matcher m;
+    char c;
+
+    SIM900MatchStart(&m);
 
-    while(1)
+    while (1)
     {
-        while (USART_DataAvailable == FALSE && n < timeout)
+        if (UARTAvailable(&SIM900_UART) == 0)
         {
-            n++;
-            _delay_ms(1);
+            if ((uint16_t)(TickNow() - start) >= ticks)
+                return 0;
+
+            wdt_reset();    // Every wait is bounded, the watchdog is for the caller's loops
+            continue;
         }
 
-        if (n == timeout)
-            return 0;
-        else
-        {
-            SIM900_buffer[i] = USART_Receive_char_ISR();
+        c = UARTGetc(&SIM900_UART);
 
-            if (SIM900_buffer[i] == 0x0D && i != 0)
-            {
-                USART_Receive_String_ISR();
-                return i+1;
-            } else
-                i++;
+        if (c == 0x0D || c == 0x0A)
+        {
+            if (i == 0)
+                continue;
+
+            SIM900_buffer[i] = '\0';
+            SIM900_line = SIM900MatchEnd(&m);
+            SIM900_heard = TRUE;
+            SIM900LineError();
+            return i;
         }
+
+        SIM900MatchByte(&m,c);
+
+        if (i < sizeof(SIM900_buffer) - 1)
+            SIM900_buffer[i++] = c;
     }
 }
 
 
 /**
- * Name: SIM900GetNetStat
- * Description: The fetch betwork state.
+ * Name: SIM900Clock
+ * Description: The function brings the seconds counter up to date. It has to run at least
+ *              once per tick period (65 s); SIM900SignalTask calls it from the idle loop.
  * @Author: Mehdi
  *
- * @Return  SIM900_FAIL: if "response" does not match "check"
+ * @Return  Seconds since power on
 */
 
-int8_t SIM900GetNetStat()
+static uint16_t SIM900Clock(void)
 {
-    SIM900Cmd("AT+CREG?");
-
-    uint16_t i = 0;
-
-    // Correct response is 20 byte long
-	// So wait until we have got 20 bytes in buffer.
-    while(i < 10)
+    while ((uint16_t)(TickNow() - SIM900_secs_tick) >= TICK_HZ)
     {
-        if (USART_LenRecData() < 20)
-        {
-            i++;
-            _delay_ms(10);
-        } else
-        {
-            SIM900_buffer = USART_Receive_String_ISR();
-
-            if(SIM900_buffer[11] = '1')
-                return SIM900_NW_REGISTERED_HOME;
-            else if(SIM900_buffer[11] = '2')
-                return SIM900_NW_SEARCHING;
-            else if(SIM900_buffer[11] = '5')
-                return SIM900_NW_REGISTED_ROAMING;
-            else
-                return SIM900_NW_ERROR;
-        }
+        SIM900_secs_tick += TICK_HZ;
+        SIM900_secs++;
     }
 
-    //We waited so long but got no response
-	//So tell caller that we timed out
-
-	return SIM900_TIMEOUT;
+    return SIM900_secs;
 }
 
 
 /**
- * Name: SIM900DeleteMsg
- * Description: The function deletes the message its number given by user.
+ * Name: SIM900DeliveryReport
+ * Description: The function applies a status report, "+CDS: <fo>,<mr>,<ra>,<tora>,<scts>,<dt>,<st>"
+ *              in text mode, to the message it belongs to. <st> 0..31 is final delivery,
+ *              32..63 means the centre is still trying, anything else is a final failure.
+ *              Reports for a message whose slot was reused meanwhile are dropped.
  * @Author: Mehdi
  *
- * @Params	msgNum: Number of message should be deleted.
- * @Retun   messages shows the function successfully delted the message (SIM900_OK),
- *          fail to carry out the request (SIM900_FAIL). and did not get any response from module (SIM900_TIMEOUT)
+ * @Params	line: The +CDS line
 */
 
-int8_t SIM900DeleteMsg(uint8_t msgNum)
+static void SIM900DeliveryReport(const char *line)
 {
+    const char *mr = strchr(line,',');      // <mr> follows <fo>
+    const char *st = strrchr(line,',');     // <st> is the last field
+    SIM900Delivery *d;
+    uint8_t ref;
 
-    USART_RxBufferFlush();  // Clear pending data in queue
+    if (mr == NULL || st == mr)
+        return;
 
-    char cmd[16];   // String for storing the command to be sent
+    ref = FmtNum(mr + 1);
+    d = &SIM900_dlr[ref & (SIM900_DLR_SLOTS - 1)];
 
-    sprintf(cmd,"AT+CMGD=%d",msgNum);   // AT+CMGD=<n>
+    if (d->status != SIM900_DLR_PENDING || d->ref != ref)
+        return;
 
-    SIM900Cmd(cmd);
+    d->st = FmtNum(st + 1);
 
-    uint8_t len = SIM900WaitForResponse(1000);
+    SIM900TraceUrc(SIM900_CMD_CDS);
 
-    if (len == 0)
-         return SIM900_TIMEOUT;
+    if (d->st >= 32 && d->st < 64)
+        return;     // Temporary error, a final report follows
 
-    SIM900_buffer[len - 1] = '\0';
+    d->delay = SIM900Clock() - d->sent;
 
-    //Check if the response is OK
-    if (strcasecmp(SIM900_buffer+2,"OK") == 0)
-        return SIM900_OK;
+    if (d->st < 32)
+    {
+        d->status = SIM900_DLR_DELIVERED;
+
+        if (SIM900_dlr_stats.delivered++ == 0 || d->delay < SIM900_dlr_stats.delay_min)
+            SIM900_dlr_stats.delay_min = d->delay;
+        if (d->delay > SIM900_dlr_stats.delay_max)
+            SIM900_dlr_stats.delay_max = d->delay;
+
+        SIM900_dlr_stats.delay_sum += d->delay;
+    }
     else
-        return SIM900_FAIL;
+    {
+        d->status = SIM900_DLR_FAILED;
+        SIM900_dlr_stats.failed++;
+    }
 }
 
 
 /**
- * Name: SIM900WaitForMsg
- * Description: The function waits for the message, and when it is received by module,
- *              the function return the slot in SIM in which the incoming message stores.
+ * Name: SIM900SlotSet
+ * Description: The function marks a storage slot occupied or free.
  * @Author: Mehdi
  *
- * @Params	id (Out): The number of the slot in SIM message stores in
+ * @Params	slot: Slot number, 1 .. slots of the memory
+ * @Params	used: TRUE: occupied, FALSE: free
 */
 
-int8_t SIM900WaitForMsg(uint8_t *id)
+static void SIM900SlotSet(uint8_t slot, uint8_t used)
 {
-    uint8_t len = SIM900WaitForResponse(250);   // Get the length of received response
+    uint8_t mask;
 
-    if (len == 0)
-        return SIM900_TIMEOUT;
+    if (slot == 0 || slot > SIM900_store_total)
+        return;
 
-    SIM900_buffer[len - 1] = '\0';  // Convert char array to string
+    slot--;
+    mask = 1 << (slot & 7);
 
-    if (strcasecmp(SIM900_buffer+2,"+CMTI:",6) == 0)
+    if (used && !(SIM900_store[slot >> 3] & mask))
+    {
+        SIM900_store[slot >> 3] |= mask;
+        SIM900_store_used++;
+    }
+    else if (!used && (SIM900_store[slot >> 3] & mask))
     {
-        char str_id[4];
+        SIM900_store[slot >> 3] &= ~mask;
+        SIM900_store_used--;
+    }
+}
 
-        char *start;
 
-        start = strchr(SIM900_buffer,',');  // Find the first "," in the string and put the following char in start
-        start++;
+/**
+ * Name: SIM900CopyBody
+ * Description: The SIM900ReadMsg consumer, it appends a body chunk to the caller's
+ *              buffer and drops what does not fit.
+ * @Author: Mehdi
+ *
+ * @Params	chunk: Body chars
+ * @Params	len: Chars in chunk
+ * @Params	ctx: SIM900BodyCopy
+*/
 
-        strcpy(str_id,start);
+static void SIM900CopyBody(const char *chunk, uint8_t len, void *ctx)
+{
+    SIM900BodyCopy *copy = ctx;
 
-        *id = atoi(str_id);
+    if (len > copy->room)
+        len = copy->room;
 
-        return SIM900_OK;
-    } else
-        return SIM900_FAIL;
+    memcpy(copy->p,chunk,len);
+    copy->p += len;
+    copy->room -= len;
+    *copy->p = '\0';
 }
 
 
 /**
- * Name: SIM900ReadMsg
- * Description: The reads the message its number given bu the user.
- * The command that is used to read a text message from any slot is AT+CMGR=<n>
- * where <n> is an integer value indicating the sms slot to read. As I have already
- * discussed that their are several slots to hold incoming messages.
- *
- * The response is like this
+ * Name: SIM900FmtField
+ * Description: The function writes a label and a number, a field of the status reports.
+ * @Author: Mehdi
  *
- *       +CMGR: "STATUS","OA",,"SCTS"<CR><LF>Message Body<CR><LF><CR><LF>OK<CR><LF>
+ * @Params	p: Where to write
+ * @Params	end: End of the buffer, kept for the terminator
+ * @Params	label: Label in program memory
+ * @Params	v: The number
+ * @Return  The new end of the text
+*/
+
+static char *SIM900FmtField(char *p, char *end, const char *label, uint16_t v)
+{
+    return FmtU16(FmtStrF(p,end,label),end,v);
+}
+
+
+/**
+ * Name: SIM900Hash
+ * Description: The function folds a string into a 32 bit FNV-1a hash.
+ * @Author: Mehdi
  *
- * where STATUS indicate the status of message it could be REC UNREAD or REC READ
- * OA is the Originating Address that means the mobile number of the sender.
- * SCTS is the Service Center Time Stamp.
+ * @Params	h: Hash so far, 2166136261 to start
+ * @Params	s: The string
+ * @Return  The new hash
+*/
+
+static uint32_t SIM900Hash(uint32_t h, const char *s)
+{
+    while (*s)
+    {
+        h ^= (uint8_t)*s++;
+        h *= 16777619UL;
+    }
+
+    return h;
+}
+
+
+/**
+ * Name: SIM900SeenMsg
+ * Description: The function looks a message up among the recently read ones and adds it
+ *              when it is new. The two entries of its set are compared, a new message
+ *              replaces the older one, so the lookup takes the same time at any fill
+ *              and the window holds the last 2 * SIM900_DUP_SETS messages at least.
+ * @Author: Mehdi
  *
+ * @Params	h: Hash of the originator, time stamp and body
+ * @Return  TRUE if the message was read before
+*/
+
+static uint8_t SIM900SeenMsg(uint32_t h)
+{
+    uint8_t set, old;
+
+    if (h == 0)
+        h = 1;      // 0 marks a free entry
+
+    set = h & (SIM900_DUP_SETS - 1);
+
+    if (SIM900_dup[set][0] == h || SIM900_dup[set][1] == h)
+        return TRUE;
+
+    old = (SIM900_dup_old[set >> 3] >> (set & 7)) & 1;
+
+    SIM900_dup[set][old] = h;
+    SIM900_dup_old[set >> 3] ^= 1 << (set & 7);
+
+    return FALSE;
+}
+
+
+/**
+ * Name: SIM900SignalSample
+ * Description: The function stores a +CSQ sample. The reported <rssi> is smoothed with
+ *              an exponential average (1/4 weight to the new sample) held in 1/16 steps,
+ *              so one bad reading does not make the signal bars jump.
  * @Author: Mehdi
  *
- * @Params	msgNum (In): The data (char) get to Transmit to through USART
- * @Params	msg (Out): the message sent to the module
+ * @Params	rssi: <rssi> reported by the module, 0..31 or 99
+ *          ber: <ber> reported by the module, 0..7 or 99
 */
 
-int8_t SIM900ReadMsg(uint8_t msgNum, char *msg)
+static void SIM900SignalSample(uint8_t rssi, uint8_t ber)
 {
+    SIM900_signal.ber = ber;
 
-    USART_RxBufferFlush();    // Clear pending data in queue
+    if (rssi > 31)
+        return;     // Not known or not detectable, keep the previous average
 
-    char cmd[16];
+    if (SIM900_csq_avg == 0xFF)
+    {
+        SIM900_csq_avg = rssi << 4;
+        SIM900_signal.rssi_min = rssi;
+        SIM900_signal.rssi_max = rssi;
+    } else
+        SIM900_csq_avg = SIM900_csq_avg - (SIM900_csq_avg >> 2) + (rssi << 2);
 
-    // Build command string
-    sprintf(cmd,"AT+CMGR=%d",msgNum);
+    if (rssi < SIM900_signal.rssi_min) SIM900_signal.rssi_min = rssi;
+    if (rssi > SIM900_signal.rssi_max) SIM900_signal.rssi_max = rssi;
 
-    // Send Command
-    SIM900Cmd(cmd);
+    SIM900_signal.rssi = (SIM900_csq_avg + 8) >> 4;
 
-    uint8_t len = SIM900WaitForResponse(1000);
+    if (SIM900_signal.samples < 0xFFFF)
+        SIM900_signal.samples++;
+}
 
-    if (len == 0)
-        return SIM900_TIMEOUT;
 
-	// Check of SIM NOT Ready error
-    if (strcasecmp(SIM900_buffer+2,"+CMS ERROR: 517")==0)
+/**
+ * Name: SIM900Urc
+ * Description: The function handles the unsolicited result codes the library tracks.
+ *              +CREG: <stat> (enabled by AT+CREG=1) and the +CREG: <n>,<stat> answer
+ *              of AT+CREG? both update the cached registration state.
+ *              +CMTI: "SM",<n> is queued for SIM900WaitForMsg, so a notification that
+ *              arrives during another exchange is not lost, and marks the slot occupied.
+ *              +CDS (status report) completes the delivery state of a sent message.
+ *              +CSQ: <rssi>,<ber> updates the cached signal quality.
+ *              The readiness URCs sent at power on set the SIM900_READY_xxx flags, the
+ *              same lines answer AT+CFUN? and AT+CPIN?, +CCALR: 1 stands for Call Ready.
+ *              CLOSED (the server closed the TCP connection) and +PDP: DEACT (the network
+ *              dropped the GPRS bearer) update the connection state.
+ * @Author: Mehdi
+ *
+ * @Params	cls: SIM900_LINE_xxx of the line
+ * @Params	line: a line received from module
+ * @Return  TRUE if the line was consumed, FALSE otherwise
+*/
+
+static uint8_t SIM900Urc(uint8_t cls, const char *line)
+{
+    switch (cls)
+    {
+    case SIM900_LINE_RDY:
+    case SIM900_LINE_CFUN:
+    case SIM900_LINE_CPIN:
+    case SIM900_LINE_CALL:
+    {
+        uint8_t i = cls - SIM900_LINE_RDY;
+
+        if (!(SIM900_ready & (1 << i)))
+        {
+            SIM900_ready |= 1 << i;
+            SIM900_ready_at[i] = TickNow() - SIM900_boot_start;
+        }
+
+        return TRUE;
+    }
+
+    case SIM900_LINE_CREG:
     {
-        return SIM900_SIM_NOT_READY;    // SIM NOT Ready
+        const char *stat = strchr(line + 7,',');
+
+        SIM900_creg = FmtNum(stat ? stat + 1 : line + 7);
+        SIM900TraceUrc(SIM900_CMD_CREG);
+
+        return TRUE;
     }
 
-    // MSG Slot Empty
-    if (strcasecmp(SIM900_buffer+2,"OK")==0)
+    case SIM900_LINE_CMTI:
     {
-        return SIM900_MSG_EMPTY;
+        const char *slot = strchr(line,',');   // The slot follows the first ","
+
+        if (slot && SIM900_cmti_count < SIM900_CMTI_QUEUE)
+        {
+            SIM900_cmti[(SIM900_cmti_head + SIM900_cmti_count++) % SIM900_CMTI_QUEUE] = FmtNum(slot + 1);
+            SIM900TraceUrc(SIM900_CMD_CMTI);
+        }
+
+        if (slot)
+            SIM900SlotSet(FmtNum(slot + 1),TRUE);     // A full queue leaves it to SIM900NextMsg
+
+        return TRUE;
     }
 
-    // Now read the actual msg text
-    len = SIM900WaitForResponse(1000);
+    case SIM900_LINE_CLOSED:
+        SIM900_tcp = SIM900_TCP_CLOSED;
+        SIM900TraceUrc(SIM900_CMD_CIP);
 
-    if (len == 0)
-        return SIM900_TIMEOUT;
+        return TRUE;
 
-    SIM900_buffer[len-1]='\0';
-    strcpy(msg,SIM900_buffer+1); // +1 for removing trailing LF of prev line
+    case SIM900_LINE_DEACT:
+        SIM900_tcp = SIM900_TCP_CLOSED;
+        SIM900_gprs = FALSE;
+        SIM900TraceUrc(SIM900_CMD_CIP);
 
-    return SIM900_OK;
+        return TRUE;
+
+    case SIM900_LINE_CSQ:
+    {
+        const char *ber = strchr(line,',');
+
+        SIM900SignalSample(FmtNum(line + 6), ber ? FmtNum(ber + 1) : SIM900_CSQ_UNKNOWN);
+
+        return TRUE;
+    }
 
+    case SIM900_LINE_CDS:
+        SIM900DeliveryReport(line);
+
+        return TRUE;
+    }
+
+    return FALSE;
 }
 
 
 /**
- * Name: SIM900SendMsg
- * Description: The function send a given message  to given phone number via the module, then return message returned.
+ * Name: SIM900Line
+ * Description: The function returns the next line that is not a tracked URC, URCs
+ *              received meanwhile are handled.
  * @Author: Mehdi
  *
- * @Params	num (In): Phone number to which the message send ex "+919XXXXXXX"
- * @Params	msg (In): Message Body ex "This a message body"
- * @Params  msg_ref (Out): After successful send, the function stores a unique message reference in this variable.
+ * @Params	ticks: the time uC waits
+ * @Return  Length of the line in SIM900_buffer, 0 on timeout
 */
 
-int8_t SIM900SendMsg(const char *num, const char *msg, uint8_t *msg_ref)
+static uint8_t SIM900Line(uint16_t ticks)
 {
-    USART_RxBufferFlush();     // Clear pending data in queue
+    uint16_t start = TickNow();
+    uint16_t elapsed;
+    uint8_t len;
 
-    char cmd[25];
+    if (SIM900_held)
+    {
+        len = SIM900_held;
+        SIM900_held = 0;
+        return len;
+    }
 
-    // Creating AT+CMGS="+919XXXXXXX"
-    sprintf(cmd,"AT+CMGS= %s",num);     // AT+CMGS=+919XXXXXXX
+    do
+    {
+        elapsed = TickNow() - start;
+        len = SIM900ReadLine(elapsed < ticks ? ticks - elapsed : 0);
+    } while (len && SIM900Urc(SIM900_line,SIM900_buffer));
 
-    cmd[8] = 0x22;  // add " to cmd in 8th char
+    return len;
+}
 
-    uint8_t n = strlen(cmd);
 
-    cmd[n] = 0x22;  // add " to cmd last char
-    cmd[n+1] = '\0';
+/**
+ * Name: SIM900Drain
+ * Description: The function consumes the lines pending in queue before a new command,
+ *              URCs are handled, anything else is stale and dropped.
+ * @Author: Mehdi
+*/
 
-    SIM900Cmd(cmd);     // Send the command
+static void SIM900Drain(void)
+{
+    SIM900_held = 0;
 
-    _delay_ms(100);
+    while (SIM900Line(0));
+}
 
-    USART_Transmit_String(msg);
 
-    USART_Transmit_char(0x1A);
+/**
+ * Name: SIM900IsError
+ * Description: The function checks if a line is a final error result.
+ * @Author: Mehdi
+ *
+ * @Params	cls: SIM900_LINE_xxx of the line
+ * @Return  TRUE for ERROR, +CMS ERROR and +CME ERROR
+*/
 
-    while( USART_LenRecData() < (strlen(msg)+5) );
+static uint8_t SIM900IsError(uint8_t cls)
+{
+    return cls == SIM900_LINE_ERROR || cls == SIM900_LINE_CMS || cls == SIM900_LINE_CME;
+}
 
-    uint8_t len = SIM900WaitForResponse(6000);
 
-    if (len == 0)
-        return SIM900_TIMEOUT;
+/**
+ * Name: SIM900WaitOK
+ * Description: The function waits for the final result of a command, the
+ *              intermediate lines are skipped.
+ * @Author: Mehdi
+ *
+ * @Params	timeout: the amount of time (milisec) uC waits
+ * @Return  SIM900_OK, SIM900_FAIL for an error result, SIM900_TIMEOUT
+*/
 
-    SIM900_buffer[len-1] - '\0';
+static int8_t SIM900WaitOK(uint16_t timeout)
+{
+    uint16_t start = TickNow();
+    uint16_t ticks = TICKS_MS(timeout);
+    uint16_t elapsed;
 
-    if(strcasecmp(SIM900_buffer+2,"CMGS:",5) == 0)
+    while ((elapsed = TickNow() - start) < ticks)
     {
-        *msg_ref = atoi(SIM900_buffer+8);
+        if (SIM900Line(ticks - elapsed) == 0)
+            break;
 
-        USART_RxBufferFlush();     // Clear pending data in queue
+        if (SIM900_line == SIM900_LINE_OK)
+            return SIM900_OK;
 
-        return SIM900_OK
-    } else
-    {
-        USART_RxBufferFlush();  // Clear pending data in queue
-        return SIM900_FAIL;
+        if (SIM900IsError(SIM900_line))
+            return SIM900_FAIL;
     }
+
+    return SIM900_TIMEOUT;
+}
+
+
+/**
+ * Name: SIM900WaitPrompt
+ * Description: The function waits for the "> " prompt the module sends when it is ready
+ *              for data. The prompt has no line end, so it is read char by char and the
+ *              matcher spots it on its first byte; whole lines received before it (echo,
+ *              URCs) are handled or skipped.
+ * @Author: Mehdi
+ *
+ * @Params	timeout: the amount of time (milisec) uC waits
+ * @Return  SIM900_OK, SIM900_FAIL for an error result, SIM900_TIMEOUT
+*/
+
+static int8_t SIM900WaitPrompt(uint16_t timeout)
+{
+    uint16_t start = TickNow();
+    uint16_t ticks = TICKS_MS(timeout);
+    uint8_t i = 0;
+    SIM900Matcher m;
+    char c;
+
+    SIM900MatchStart(&m);
+
+    // A line SIM900Cmd took for the response
+    if (SIM900_held)
+    {
+        SIM900_held = 0;
+
+        if (SIM900IsError(SIM900_line))
+            return SIM900_FAIL;
+    }
+
+    while ((uint16_t)(TickNow() - start) < ticks)
+    {
+        if (UARTAvailable(&SIM900_UART) == 0)
+        {
+            wdt_reset();
+            continue;
+        }
+
+        c = UARTGetc(&SIM900_UART);
+
+        if (c == 0x0D || c == 0x0A)
+        {
+            if (i == 0)
+                continue;
+
+            SIM900_buffer[i] = '\0';
+            SIM900_line = SIM900MatchEnd(&m);
+            SIM900MatchStart(&m);
+            SIM900LineError();
+            i = 0;
+
+            if (!SIM900Urc(SIM900_line,SIM900_buffer) && SIM900IsError(SIM900_line))
+                return SIM900_FAIL;
+
+            continue;
+        }
+
+        if (SIM900MatchByte(&m,c) == SIM900_LINE_PROMPT)
+        {
+            // Take the blank after the prompt as well
+            start = TickNow();
+
+            while (UARTAvailable(&SIM900_UART) == 0 && (uint16_t)(TickNow() - start) < TICKS_MS(SIM900_LINE_TIME));
+
+            if (UARTPeek(&SIM900_UART) == ' ')
+                UARTGetc(&SIM900_UART);
+
+            return SIM900_OK;
+        }
+
+        if (i < sizeof(SIM900_buffer) - 1)
+            SIM900_buffer[i++] = c;
+    }
+
+    return SIM900_TIMEOUT;
+}
+
+
+/**
+ * Name: SIM900CancelEntry
+ * Description: The function sends ESC (0x1B), which ends the text or data entry started
+ *              by a "> " prompt without sending anything, so the next command is not
+ *              taken as message body. A port held by CTS gets SIM900_CMD_TIMEOUT to make
+ *              room, a modem stalled for longer is left to the liveness supervisor.
+ * @Author: Mehdi
+*/
+
+static void SIM900CancelEntry(void)
+{
+    uint16_t start = TickNow();
+
+    while (UARTTxRoom(&SIM900_UART) == 0)
+    {
+        if ((uint16_t)(TickNow() - start) >= TICKS_MS(SIM900_CMD_TIMEOUT))
+            return;
+
+        wdt_reset();
+    }
+
+    UARTPutc(&SIM900_UART,0x1B);
+}
+
+
+/**
+ * Name: SIM900BootBegin
+ * Description: The function clears the readiness state and starts SIM900BootTask at a step.
+ * @Author: Mehdi
+ *
+ * @Params	step: SIM900_BOOT_xxx
+*/
+
+static void SIM900BootBegin(uint8_t step)
+{
+    SIM900_held = 0;
+    SIM900_ready = 0;
+    memset(SIM900_ready_at,0,sizeof(SIM900_ready_at));
+
+    SIM900_boot_start = TickNow();
+    SIM900_boot_step = SIM900_boot_start;
+    SIM900_boot_n = 1;
+    SIM900_boot = step;
+}
+
+
+/**
+ * Name: SIM900BootStart
+ * Description: The function starts the power on sequence, SIM900BootTask carries it on.
+ *              The module is probed with AT first: a module that is already on must not
+ *              see PWRKEY, a second press switches it off.
+ * @Author: Mehdi
+*/
+
+void SIM900BootStart()
+{
+    SIM900_PWRKEY_RELEASE();
+    DDR(SIM900_PWRKEY) |= 1 << SIM900_PWRKEY_POS;
+
+    SIM900BootBegin(SIM900_BOOT_PROBE);
+
+    UARTPutsF(&SIM900_UART,PSTR("AT"));
+    UARTPutc(&SIM900_UART,0x0D);
+}
+
+
+/**
+ * Name: SIM900BootTask
+ * Description: The function carries on the power on sequence started by SIM900BootStart.
+ *              It never waits longer than a line takes to arrive, so the caller can
+ *              initialize the rest of the board between calls. Each step ends as soon as
+ *              the line it waits for arrives:
+ *              probe   AT is answered: the module is on, AT+CPIN?;+CFUN?;+CCALR? reads
+ *                      its state. No answer: PWRKEY is pressed.
+ *              pwrkey  PWRKEY is released after SIM900_PWRKEY_TIME.
+ *              wait    RDY, +CFUN: 1, +CPIN: READY and Call Ready are collected, AT is
+ *                      sent now and then until the first of them to lock the autobaud.
+ *              off     Power cycle of the liveness supervisor: PWRKEY switches the module
+ *                      off, after SIM900_OFF_TIME the sequence starts over with the probe.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_BUSY: not ready yet, SIM900_OK: +CPIN: READY and Call Ready seen,
+ *          SIM900_TIMEOUT: the module did not get ready in SIM900_BOOT_TIMEOUT
+*/
+
+int8_t SIM900BootTask()
+{
+    uint8_t ok = FALSE;
+
+    if (SIM900_boot == SIM900_BOOT_IDLE)
+        return ((SIM900_ready & SIM900_READY_ALL) == SIM900_READY_ALL) ? SIM900_OK : SIM900_TIMEOUT;
+
+    // Readiness URCs are taken by SIM900Urc, only the probe answers get here
+    while (UARTAvailable(&SIM900_UART))
+    {
+        if (SIM900Line(TICKS_MS(SIM900_LINE_TIME)) == 0)
+            break;
+
+        if (SIM900_line == SIM900_LINE_OK)
+            ok = TRUE;
+    }
+
+    if ((SIM900_ready & SIM900_READY_ALL) == SIM900_READY_ALL)
+    {
+        SIM900_boot = SIM900_BOOT_IDLE;
+        return SIM900_OK;
+    }
+
+    uint16_t now = TickNow();
+
+    if ((uint16_t)(now - SIM900_boot_start) >= TICKS_MS(SIM900_BOOT_TIMEOUT))
+    {
+        SIM900_PWRKEY_RELEASE();
+        SIM900_boot = SIM900_BOOT_IDLE;
+        return SIM900_TIMEOUT;
+    }
+
+    switch (SIM900_boot)
+    {
+        case SIM900_BOOT_PROBE:
+            if (ok)
+            {
+                // Already on, it will not repeat the URCs, so ask
+                UARTPutsF(&SIM900_UART,PSTR("AT+CPIN?;+CFUN?;+CCALR?"));
+                UARTPutc(&SIM900_UART,0x0D);
+
+                SIM900_boot = SIM900_BOOT_WAIT;
+                SIM900_boot_step = now;
+            } else if ((uint16_t)(now - SIM900_boot_step) >= TICKS_MS(SIM900_PROBE_TIME))
+            {
+                SIM900_boot_step = now;
+
+                if (SIM900_boot_n++ < SIM900_PROBE_TRIES)
+                {
+                    UARTPutsF(&SIM900_UART,PSTR("AT"));
+                    UARTPutc(&SIM900_UART,0x0D);
+                } else
+                {
+                    SIM900_PWRKEY_PRESS();
+                    SIM900_boot = SIM900_BOOT_PWRKEY;
+                }
+            }
+            break;
+
+        case SIM900_BOOT_PWRKEY:
+            if ((uint16_t)(now - SIM900_boot_step) >= TICKS_MS(SIM900_PWRKEY_TIME))
+            {
+                SIM900_PWRKEY_RELEASE();
+                SIM900_boot = SIM900_BOOT_WAIT;
+                SIM900_boot_step = now;
+            }
+            break;
+
+        case SIM900_BOOT_WAIT:
+            // With autobaud the module stays silent until it has seen an AT
+            if (SIM900_ready == 0 && (uint16_t)(now - SIM900_boot_step) >= TICKS_MS(SIM900_SYNC_TIME))
+            {
+                SIM900_boot_step = now;
+
+                UARTPutsF(&SIM900_UART,PSTR("AT"));
+                UARTPutc(&SIM900_UART,0x0D);
+            }
+            break;
+
+        case SIM900_BOOT_OFF:
+            if ((uint16_t)(now - SIM900_boot_step) >= TICKS_MS(SIM900_PWRKEY_TIME + SIM900_OFF_TIME))
+                SIM900BootStart();      // Probes, finds it off and powers it on
+            else if ((uint16_t)(now - SIM900_boot_step) >= TICKS_MS(SIM900_PWRKEY_TIME))
+                SIM900_PWRKEY_RELEASE();
+            break;
+    }
+
+    return SIM900_BUSY;
+}
+
+
+/**
+ * Name: SIM900BootReady
+ * Description: The function returns the readiness URCs seen since SIM900BootStart.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_READY_xxx flags
+*/
+
+uint8_t SIM900BootReady()
+{
+    return SIM900_ready;
+}
+
+
+/**
+ * Name: SIM900BootTime
+ * Description: The function returns the time to ready, from SIM900BootStart to the
+ *              later of +CPIN: READY and Call Ready.
+ * @Author: Mehdi
+ *
+ * @Return  Time in ms, 0 if the module is not ready
+*/
+
+uint16_t SIM900BootTime()
+{
+    uint16_t cpin = SIM900_ready_at[2];
+    uint16_t call = SIM900_ready_at[3];
+
+    if ((SIM900_ready & SIM900_READY_ALL) != SIM900_READY_ALL)
+        return 0;
+
+    return MS_TICKS(cpin > call ? cpin : call);
+}
+
+
+/**
+ * Name: SIM900BootFormat
+ * Description: The function writes the time (ms) each readiness URC took after
+ *              SIM900BootStart, ex "RDY:1830 CFUN:2050 CPIN:2110 CALL:6400", a URC
+ *              not seen is shown as "-".
+ * @Author: Mehdi
+ *
+ * @Params	buf (Out): Output buffer
+ * @Params	size: Size of the buffer
+ * @Return  Length of the text
+*/
+
+uint8_t SIM900BootFormat(char *buf, uint8_t size)
+{
+    static const char name[4][7] PROGMEM = { "RDY:", " CFUN:", " CPIN:", " CALL:" };
+    char *p = buf, *end = buf + size - 1;
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        p = FmtStrF(p,end,name[i]);
+
+        if (SIM900_ready & (1 << i))
+            p = FmtU16(p,end,MS_TICKS(SIM900_ready_at[i]));
+        else
+            p = FmtChar(p,end,'-');
+    }
+
+    *p = '\0';
+
+    return p - buf;
+}
+
+
+/**
+ * Name: SIM900ProfileCheck
+ * Description: The function reads the settings of the profile back with a single query.
+ *              The answers must come in order and without the echo of the query.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_OK: the profile is in effect, SIM900_FAIL: it is not, SIM900_TIMEOUT
+*/
+
+static int8_t SIM900ProfileCheck(void)
+{
+    uint16_t start, ticks = TICKS_MS(SIM900_CMD_TIMEOUT);
+    uint16_t elapsed;
+    uint8_t n = 0, echo;
+
+    SIM900Drain();
+
+    SIM900_echo = TRUE;     // Not known yet, SIM900Cmd tells
+
+    if (SIM900CmdF(SIM900_profile_query) != SIM900_OK)
+        return SIM900Result(SIM900_TIMEOUT);
+
+    echo = (SIM900_held == 0);
+
+    start = TickNow();
+
+    while ((elapsed = TickNow() - start) < ticks)
+    {
+        if (SIM900Line(ticks - elapsed) == 0)
+            break;
+
+        if (SIM900_line == SIM900_LINE_OK)
+        {
+            if (echo || n != SIM900_PROFILE_LINES)
+                return SIM900Result(SIM900_FAIL);
+
+            SIM900_echo = FALSE;
+
+            return SIM900Result(SIM900_OK);
+        }
+
+        if (SIM900IsError(SIM900_line))
+            return SIM900Result(SIM900_FAIL);
+
+        if (n < SIM900_PROFILE_LINES && strcmp_P(SIM900_buffer,SIM900_profile_ans[n]) == 0)
+            n++;
+    }
+
+    return SIM900Result(SIM900_TIMEOUT);
+}
+
+
+/**
+ * Name: SIM900Profile
+ * Description: The function makes sure the module runs with the library profile:
+ *              echo off (ATE0), text mode SMS (+CMGF=1), +CMTI for new messages
+ *              and +CDS for status reports (+CNMI=2,1,0,1,0), numeric errors (+CMEE=1),
+ *              the GSM character set, a status report for every message sent
+ *              (+CSMP=49,167,0,0) and, with SIM900_FLOW, RTS/CTS flow control (+IFC=2,2).
+ *              A stored profile is detected with one query and left as it is, otherwise
+ *              the whole profile is sent in one command line, read back and stored with
+ *              AT&W so the next boots find it.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_OK, SIM900_FAIL if the module refused the profile, SIM900_TIMEOUT
+*/
+
+int8_t SIM900Profile()
+{
+    int8_t response = SIM900ProfileCheck();
+
+    if (response != SIM900_FAIL)
+        return response;
+
+    SIM900CmdF(SIM900_profile_set);
+
+    // The module answers without echo already
+    response = SIM900Result(SIM900WaitOK(SIM900_CMD_TIMEOUT));
+
+    if (response != SIM900_OK)
+        return response;
+
+    response = SIM900ProfileCheck();
+
+    if (response != SIM900_OK)
+        return response;
+
+    SIM900CmdF(PSTR("AT&W"));      // Store the profile
+
+    return SIM900Result(SIM900WaitOK(SIM900_CMD_TIMEOUT));
+}
+
+
+/**
+ * Name: SIM900Init
+ * Description: The funtion initializes the SIM900 module by sending
+ *              "AT" command, get the response and check it out to see if module works fine.
+ *              It makes sure the module runs with the library profile (SIM900Profile)
+ *              and selects and maps the message memory (SIM900Storage).
+ *              Then it enables the +CREG URC and fetches the current registration state,
+ *              from then on the state is tracked without polling.
+ * @Author: Mehdi
+ *
+ * @Return	Messages indicates if the module works fine (SIM900_OK) or not (SIM900_TIMEOUT, SIM900_FAIL)
+*/
+
+int8_t SIM900Init()
+{
+    int8_t response;
+
+    SIM900Drain();
+
+    SIM900CmdF(PSTR("AT"));    // Test command
+
+    response = SIM900Result(SIM900WaitOK(SIM900_CMD_TIMEOUT));
+
+    if (response != SIM900_OK)
+        return response;
+
+    response = SIM900Profile();
+
+    if (response != SIM900_OK)
+        return response;
+
+    // Without a usable memory (no SIM) messages are not tracked, the rest still works
+    if (SIM900Storage() == SIM900_TIMEOUT)
+        return SIM900_TIMEOUT;
+
+    SIM900CmdF(PSTR("AT+CREG=1"));     // Report registration changes with +CREG: <stat>
+
+    response = SIM900Result(SIM900WaitOK(SIM900_CMD_TIMEOUT));
+
+    if (response != SIM900_OK)
+        return response;
+
+    // The URC only reports changes, so read the current state once
+    if (SIM900GetNetStat() == SIM900_TIMEOUT)
+        return SIM900_TIMEOUT;
+
+    // The module just answered, the supervisor starts counting from here
+    SIM900_live_at = SIM900Clock();
+
+    // Take the first signal sample on the next SIM900SignalTask call
+    SIM900_csq_tick = TickNow();
+    SIM900_csq_secs = SIM900_csq_period;
+
+    return SIM900_OK;
+}
+
+
+/**
+ * Name: SIM900CmdSend
+ * Description: The function send the given command to the module and
+ *              waits for the module to echo it. If echo is off the first
+ *              response line is kept for the caller. Once the profile has
+ *              turned echo off (SIM900Profile) nothing is waited for.
+ * @Author: Mehdi
+ *
+ * @Params	cmd: The command wanted to send to module
+ * @Params	flash: TRUE if cmd is in program memory
+ * @Return	Messages indicates if the module works fine (SIM900_OK) or not (SIM900_TIMEOUT)
+*/
+
+static int8_t SIM900CmdSend(const char *cmd, uint8_t flash)
+{
+    if (flash)
+    {
+        char head[SIM900_CMD_HEAD + 1];     // Enough of it for SIM900CmdClass
+
+        strncpy_P(head,cmd,SIM900_CMD_HEAD);
+        head[SIM900_CMD_HEAD] = '\0';
+
+        SIM900TraceCmd(SIM900CmdClass(head));
+        UARTPutsF(&SIM900_UART,cmd);
+    } else
+    {
+        SIM900TraceCmd(SIM900CmdClass(cmd));
+        UARTPuts(&SIM900_UART,cmd);
+    }
+
+    SIM900_err_cls = SIM900_ERR_NONE;
+
+    UARTPutc(&SIM900_UART,0x0D);  // CR
+
+    if (!SIM900_echo)
+        return SIM900_OK;       // The caller reads the response
+
+    uint8_t len = SIM900Line(TICKS_MS(SIM900_CMD_TIMEOUT));
+
+    if (len == 0)
+        return SIM900_TIMEOUT;
+
+    if ((flash ? strcasecmp_P(SIM900_buffer,cmd) : strcasecmp(SIM900_buffer,cmd)) != 0)
+        SIM900_held = len;      // Not the echo, it is the response
+
+    return SIM900_OK;
+}
+
+
+/**
+ * Name: SIM900Cmd
+ * Description: The function sends a command built in RAM, see SIM900CmdSend.
+ * @Author: Mehdi
+ *
+ * @Params	cmd: The command wanted to send to module
+ * @Return	SIM900_OK, SIM900_TIMEOUT
+*/
+
+int8_t SIM900Cmd(const char *cmd)
+{
+    return SIM900CmdSend(cmd,FALSE);
+}
+
+
+/**
+ * Name: SIM900CmdF
+ * Description: The function sends a command kept in flash (PSTR), see SIM900CmdSend.
+ *              Fixed commands go this way so their text takes no SRAM.
+ * @Author: Mehdi
+ *
+ * @Params	cmd: The command wanted to send to module, in program memory
+ * @Return	SIM900_OK, SIM900_TIMEOUT
+*/
+
+int8_t SIM900CmdF(const char *cmd)
+{
+    return SIM900CmdSend(cmd,TRUE);
+}
+
+
+/**
+ * Name: SIM900CheckResponse
+ * Description: The function check the response received from module
+ *              and return back appropriate feedback.
+ * @Author: Mehdi
+ *
+ * @Params	response: the response get from module and check by the function
+ * @Params  check: the word with witch "response" is compared
+ * @Params  len: length of "response" should be compare with "check"
+ * @Return  SIM900_INVALID_RESPONSE: if two first or two last char of response are not "\n"
+ * @Return  SIM900_FAIL: if "response" does not match "check"
+*/
+
+int8_t SIM900CheckResponse(const char *response, const char *check, uint8_t len)
+{
+    len -= 2;
+
+    // Check leading CR LF
+    if (response[0] != 0x0D | response[1] != 0x0A)
+        return SIM900_INVALID_RESPONSE;
+
+    // Check leading CR LF
+    if (response[len] != 0x0D | response[len+1] != 0x0A)
+        return SIM900_INVALID_RESPONSE;
+
+    for (uint8_t i = 2; i < len; i++)
+    {
+        if(response[i] != check[i-2])
+            return SIM900_FAIL;
+    }
+
+    return SIM900_OK;
+}
+
+
+
+
+/**
+ * Name: SIM900WaitForResponse
+ * Description: The function add a given delay to receive response from module,
+ *              and if receives any response, stores the line (without CR LF)
+ *              in SIM900_buffer and return number of char response.
+ *              Tracked URCs (+CREG) received meanwhile are handled and skipped.
+ * @Author: Mehdi
+ *
+ * @Params	timeout: the amount of time (milisec) uC waits
+ * @Return  Number of char of response, 0 on timeout
+*/
+
+int8_t SIM900WaitForResponse(uint16_t timeout)
+{
+    return SIM900Line(TICKS_MS(timeout));
+}
+
+
+/**
+ * Name: SIM900GetNetStat
+ * Description: The function queries the network state with AT+CREG?. The answer
+ *              is taken by the URC handler, so the cached state is refreshed too.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_NW_xxx, or SIM900_TIMEOUT / SIM900_FAIL if the query failed
+*/
+
+int8_t SIM900GetNetStat()
+{
+    SIM900Drain();
+
+    SIM900CmdF(PSTR("AT+CREG?"));
+
+    int8_t response = SIM900WaitOK(SIM900_CMD_TIMEOUT);
+
+    if (response != SIM900_OK)
+        return SIM900Result(response);
+
+    return SIM900Result(SIM900NetStat());
+}
+
+
+/**
+ * Name: SIM900NetStat
+ * Description: The function returns the cached network state, kept up to date
+ *              by the +CREG URC. It does not talk to the module.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_NW_REGISTERED_HOME, SIM900_NW_SEARCHING, SIM900_NW_REGISTED_ROAMING or SIM900_NW_ERROR
+*/
+
+int8_t SIM900NetStat()
+{
+    switch (SIM900_creg)
+    {
+        case 1:
+            return SIM900_NW_REGISTERED_HOME;
+        case 2:
+            return SIM900_NW_SEARCHING;
+        case 5:
+            return SIM900_NW_REGISTED_ROAMING;
+        default:
+            return SIM900_NW_ERROR;
+    }
+}
+
+
+/**
+ * Name: SIM900WaitRegistered
+ * Description: The function waits until the module registers to the network (home
+ *              or roaming) and returns as soon as the +CREG URC reports it. No command
+ *              is sent, lines other than URCs received meanwhile are dropped.
+ * @Author: Mehdi
+ *
+ * @Params	timeout: the amount of time (milisec) uC waits
+ * @Return  SIM900_NW_REGISTERED_HOME, SIM900_NW_REGISTED_ROAMING or SIM900_TIMEOUT
+*/
+
+int8_t SIM900WaitRegistered(uint16_t timeout)
+{
+    uint16_t start = TickNow();
+    uint16_t ticks = TICKS_MS(timeout);
+    uint16_t elapsed;
+
+    while (SIM900_creg != 1 && SIM900_creg != 5)
+    {
+        elapsed = TickNow() - start;
+
+        if (elapsed >= ticks)
+            return SIM900_TIMEOUT;
+
+        SIM900Line(ticks - elapsed);
+    }
+
+    return SIM900NetStat();
+}
+
+
+/**
+ * Name: SIM900DeleteMsg
+ * Description: The function deletes the message its number given by user.
+ * @Author: Mehdi
+ *
+ * @Params	msgNum: Number of message should be deleted.
+ * @Retun   messages shows the function successfully delted the message (SIM900_OK),
+ *          fail to carry out the request (SIM900_FAIL). and did not get any response from module (SIM900_TIMEOUT)
+*/
+
+
+int8_t SIM900DeleteMsg(uint8_t msgNum)
+{
+
+    SIM900Drain();  // Clear pending data in queue
+
+    char cmd[16];   // String for storing the command to be sent
+
+    char *p = FmtStrF(cmd,cmd + sizeof(cmd) - 1,PSTR("AT+CMGD="));    // AT+CMGD=<n>
+
+    *FmtU8(p,cmd + sizeof(cmd) - 1,msgNum) = '\0';
+
+    SIM900Cmd(cmd);
+
+    //Check if the response is OK
+    int8_t response = SIM900WaitOK(SIM900_CMD_TIMEOUT);
+
+    if (response == SIM900_OK)
+        SIM900SlotSet(msgNum,FALSE);
+
+    return SIM900Result(response);
+}
+
+
+/**
+ * Name: SIM900WaitForMsg
+ * Description: The function waits for the message, and when it is received by module,
+ *              the function return the slot in SIM in which the incoming message stores.
+ * @Author: Mehdi
+ *
+ * @Params	id (Out): The number of the slot in SIM message stores in
+*/
+
+int8_t SIM900WaitForMsg(uint8_t *id)
+{
+    uint8_t len = 0;
+
+    // +CMTI lines are queued by the URC handler
+    if (SIM900_cmti_count == 0)
+        len = SIM900WaitForResponse(250);   // Get the length of received response
+
+    if (SIM900_cmti_count)
+    {
+        *id = SIM900_cmti[SIM900_cmti_head];
+        SIM900_cmti_head = (SIM900_cmti_head + 1) % SIM900_CMTI_QUEUE;
+        SIM900_cmti_count--;
+
+        return SIM900_OK;
+    }
+
+    if (len == 0)
+        return SIM900_TIMEOUT;
+
+    return SIM900_FAIL;
+}
+
+
+/**
+ * Name: SIM900ReadMsg
+ * Description: The reads the message its number given bu the user.
+ * The command that is used to read a text message from any slot is AT+CMGR=<n>
+ * where <n> is an integer value indicating the sms slot to read. As I have already
+ * discussed that their are several slots to hold incoming messages.
+ *
+ * The response is like this
+ *
+ *       +CMGR: "STATUS","OA",,"SCTS"<CR><LF>Message Body<CR><LF><CR><LF>OK<CR><LF>
+ *
+ * where STATUS indicate the status of message it could be REC UNREAD or REC READ
+ * OA is the Originating Address that means the mobile number of the sender.
+ * SCTS is the Service Center Time Stamp.
+ *
+ * A message with the OA, SCTS and body of one read before is a redelivered copy,
+ * the network or the operator sent it twice. It is returned as SIM900_MSG_DUPLICATE
+ * and counted in the statistics, the caller deletes it without acting on it.
+ *
+ * @Author: Mehdi
+ *
+ * The body is read by SIM900ReadMsgStream and copied to msg, up to
+ * SIM900_MSG_LEN chars.
+ *
+ * @Author: Mehdi
+ *
+ * @Params	msgNum (In): The data (char) get to Transmit to through USART
+ * @Params	msg (Out): the message sent to the module, SIM900_MSG_LEN + 1 char
+ * @Return  SIM900_OK, SIM900_MSG_DUPLICATE, SIM900_MSG_EMPTY, SIM900_SIM_NOT_READY,
+ *          SIM900_FAIL or SIM900_TIMEOUT
+*/
+
+int8_t SIM900ReadMsg(uint8_t msgNum, char *msg)
+{
+    SIM900BodyCopy copy = { msg, SIM900_MSG_LEN };
+
+    msg[0] = '\0';
+
+    return SIM900ReadMsgStream(msgNum,SIM900CopyBody,&copy);
+}
+
+
+/**
+ * Name: SIM900ReadBody
+ * Description: The function reads the body line of a message straight off the receive
+ *              ring and hands it to the consumer SIM900_CHUNK chars at a time, so the
+ *              body needs no buffer of its own and is not cut at the size of SIM900_buffer.
+ * @Author: Mehdi
+ *
+ * @Params	ticks: the time uC waits for the whole body
+ * @Params	fn: Consumer of the body, NULL to skip the body unhashed
+ * @Params	ctx: Passed to fn
+ * @Params	h (In/Out): Duplicate hash, the body is folded in, unused without fn
+ * @Return  SIM900_OK, SIM900_TIMEOUT. An empty body is SIM900_OK with no call to fn.
+*/
+
+static int8_t SIM900ReadBody(uint16_t ticks, SIM900BodyFn fn, void *ctx, uint32_t *h)
+{
+    char chunk[SIM900_CHUNK + 1];
+    uint16_t start = TickNow();
+    uint8_t n = 0;
+    uint8_t started = FALSE;
+    char c;
+
+    while (1)
+    {
+        if (UARTAvailable(&SIM900_UART) == 0)
+        {
+            if ((uint16_t)(TickNow() - start) >= ticks)
+                return SIM900_TIMEOUT;
+
+            wdt_reset();
+            continue;
+        }
+
+        c = UARTGetc(&SIM900_UART);
+
+        // SIM900ReadLine ends the +CMGR: line at its CR, the LF is still queued.
+        // The CR that follows is the end of the body, of an empty one too.
+        if (c == 0x0A && !started)
+            continue;
+
+        if (c == 0x0D || c == 0x0A)
+            break;
+
+        started = TRUE;
+
+        if (!fn)
+            continue;
+
+        chunk[n++] = c;
+
+        if (n == SIM900_CHUNK)
+        {
+            chunk[n] = '\0';
+            *h = SIM900Hash(*h,chunk);
+            fn(chunk,n,ctx);
+            n = 0;
+        }
+    }
+
+    if (n)
+    {
+        chunk[n] = '\0';
+        *h = SIM900Hash(*h,chunk);
+        fn(chunk,n,ctx);
+    }
+
+    SIM900_heard = TRUE;
+
+    return SIM900_OK;
+}
+
+
+/**
+ * Name: SIM900ReadMsgStream
+ * Description: The function reads a message like SIM900ReadMsg, but the body goes to a
+ *              consumer in chunks as it comes off the receive ring, so a parser can act
+ *              on the first token while the rest is still arriving and no buffer for the
+ *              whole body is needed. A redelivered copy is only known once the whole body
+ *              was hashed: its chunks are passed too and SIM900_MSG_DUPLICATE returned,
+ *              so the consumer should act on the return code, not on the chunks alone.
+ * @Author: Mehdi
+ *
+ * @Params	msgNum (In): Slot of the message
+ * @Params	fn: Consumer of the body
+ * @Params	ctx: Passed to fn
+ * @Return  SIM900_OK, SIM900_MSG_DUPLICATE, SIM900_MSG_EMPTY, SIM900_SIM_NOT_READY,
+ *          SIM900_FAIL or SIM900_TIMEOUT
+*/
+
+int8_t SIM900ReadMsgStream(uint8_t msgNum, SIM900BodyFn fn, void *ctx)
+{
+    uint32_t h;
+    const char *oa;
+    int8_t response;
+
+    SIM900Drain();    // Clear pending data in queue
+
+    char cmd[16];
+
+    // Build command string
+    char *p = FmtStrF(cmd,cmd + sizeof(cmd) - 1,PSTR("AT+CMGR="));
+
+    *FmtU8(p,cmd + sizeof(cmd) - 1,msgNum) = '\0';
+
+    // Send Command
+    SIM900Cmd(cmd);
+
+    uint8_t len = SIM900WaitForResponse(SIM900_CMD_TIMEOUT);
+
+    if (len == 0)
+        return SIM900Result(SIM900_TIMEOUT);
+
+	// SIM missing, locked or not ready yet
+    if (SIM900IsError(SIM900_line) && SIM900_err_cls == SIM900_ERR_SIM)
+    {
+        return SIM900Result(SIM900_SIM_NOT_READY);    // SIM NOT Ready
+    }
+
+    // MSG Slot Empty
+    if (SIM900_line == SIM900_LINE_OK)
+    {
+        SIM900SlotSet(msgNum,FALSE);
+        return SIM900Result(SIM900_MSG_EMPTY);
+    }
+
+    if (strncasecmp_P(SIM900_buffer,PSTR("+CMGR:"),6) != 0)
+        return SIM900Result(SIM900_FAIL);
+
+    SIM900SlotSet(msgNum,TRUE);
+
+    // Key from ,"OA",,"SCTS" on, the status changes once the message is read
+    oa = strchr(SIM900_buffer,',');
+    h = SIM900Hash(2166136261UL,oa ? oa : SIM900_buffer);
+
+    // Now read the actual msg text
+    if (SIM900ReadBody(TICKS_MS(SIM900_CMD_TIMEOUT),fn,ctx,&h) != SIM900_OK)
+        return SIM900Result(SIM900_TIMEOUT);
+
+    response = SIM900WaitOK(SIM900_CMD_TIMEOUT);    // Trailing OK
+
+    if (response != SIM900_OK)
+        return SIM900Result(response);
+
+    if (SIM900SeenMsg(h))
+    {
+        SIM900StatsDuplicate();
+        return SIM900Result(SIM900_MSG_DUPLICATE);
+    }
+
+    return SIM900Result(SIM900_OK);
+
+}
+
+
+/**
+ * Name: SIM900StorageSelect
+ * Description: The function selects a memory for reading, writing and receiving messages
+ *              with AT+CPMS and reads its size from the "+CPMS: <used>,<total>,..." answer.
+ * @Author: Mehdi
+ *
+ * @Params	mem: "SM" (SIM) or "ME" (module), in program memory
+ * @Params	total (Out): Slots of the memory
+ * @Return  SIM900_OK, SIM900_FAIL if the memory is not available, SIM900_TIMEOUT
+*/
+
+static int8_t SIM900StorageSelect(const char *mem, uint8_t *total)
+{
+    uint16_t start, ticks = TICKS_MS(SIM900_CMD_TIMEOUT);
+    uint16_t elapsed;
+    const char *p;
+    char cmd[32], *q = cmd, *end = cmd + sizeof(cmd) - 1;
+
+    SIM900Drain();
+
+    q = FmtStrF(q,end,PSTR("AT+CPMS="));
+
+    for (uint8_t i = 0; i < 3; i++)     // "mem","mem","mem"
+    {
+        q = FmtStrF(q,end,i ? PSTR(",\"") : PSTR("\""));
+        q = FmtStrF(q,end,mem);
+        q = FmtChar(q,end,'"');
+    }
+
+    *q = '\0';
+    SIM900Cmd(cmd);
+
+    *total = 0;
+    start = TickNow();
+
+    while ((elapsed = TickNow() - start) < ticks)
+    {
+        if (SIM900Line(ticks - elapsed) == 0)
+            break;
+
+        if (SIM900_line == SIM900_LINE_OK)
+            return (*total) ? SIM900_OK : SIM900_FAIL;
+
+        if (SIM900IsError(SIM900_line))
+            return SIM900_FAIL;
+
+        if (strncmp_P(SIM900_buffer,PSTR("+CPMS: "),7) == 0 && (p = strchr(SIM900_buffer,',')) != NULL)
+            *total = FmtNum(p + 1);
+    }
+
+    return SIM900_TIMEOUT;
+}
+
+
+/**
+ * Name: SIM900StorageScan
+ * Description: The function rebuilds the map of occupied slots from one AT+CMGL listing.
+ *              The listing leaves the status of unread messages as it is.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_OK, SIM900_FAIL, SIM900_TIMEOUT
+*/
+
+static int8_t SIM900StorageScan(void)
+{
+    uint16_t start, ticks = TICKS_MS(SIM900_LIST_TIMEOUT);
+    uint16_t elapsed;
+
+    SIM900Drain();
+
+    SIM900CmdF(PSTR("AT+CMGL=\"ALL\",1"));     // +CMGL: <index>,... and the body per message
+
+    memset(SIM900_store,0,sizeof(SIM900_store));
+    SIM900_store_used = 0;
+
+    start = TickNow();
+
+    while ((elapsed = TickNow() - start) < ticks)
+    {
+        if (SIM900Line(ticks - elapsed) == 0)
+            break;
+
+        if (SIM900_line == SIM900_LINE_OK)
+            return SIM900Result(SIM900_OK);
+
+        if (SIM900IsError(SIM900_line))
+            return SIM900Result(SIM900_FAIL);
+
+        if (strncmp_P(SIM900_buffer,PSTR("+CMGL: "),7) == 0)
+        {
+            SIM900SlotSet(FmtNum(SIM900_buffer + 7),TRUE);
+
+            // The body is read raw, a body like "OK" or "+CMTI: ..." is not a line
+            elapsed = TickNow() - start;
+
+            if (elapsed >= ticks || SIM900ReadBody(ticks - elapsed,NULL,NULL,NULL) != SIM900_OK)
+                break;
+        }
+    }
+
+    return SIM900Result(SIM900_TIMEOUT);
+}
+
+
+/**
+ * Name: SIM900Storage
+ * Description: The function selects the larger of the SIM ("SM") and module ("ME")
+ *              memories for all messages and maps its occupied slots. From then on
+ *              the map follows +CMTI, reads and deletes without asking the module.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_OK, SIM900_FAIL if no memory could be selected, SIM900_TIMEOUT
+*/
+
+int8_t SIM900Storage()
+{
+    uint8_t sm, me;
+    int8_t response;
+
+    SIM900_store_total = 0;
+
+    response = SIM900StorageSelect(PSTR("SM"),&sm);
+
+    if (response == SIM900_TIMEOUT)
+        return SIM900Result(response);
+    if (response != SIM900_OK)
+        sm = 0;
+
+    // Not every firmware offers ME for messages
+    response = SIM900StorageSelect(PSTR("ME"),&me);
+
+    if (response == SIM900_TIMEOUT)
+        return SIM900Result(response);
+    if (response != SIM900_OK)
+        me = 0;
+
+    if (sm == 0 && me == 0)
+        return SIM900Result(SIM900_FAIL);
+
+    SIM900_store_me = (me >= sm);
+
+    if (!SIM900_store_me)
+    {
+        response = SIM900StorageSelect(PSTR("SM"),&sm);
+
+        if (response != SIM900_OK)
+            return SIM900Result(response);
+    }
+
+    SIM900_store_total = SIM900_store_me ? me : sm;
+
+    if (SIM900_store_total > SIM900_STORE_MAX)
+        SIM900_store_total = SIM900_STORE_MAX;
+
+    return SIM900StorageScan();
+}
+
+
+/**
+ * Name: SIM900StorageUsed
+ * Description: The function returns the occupancy of the selected memory, no command is sent.
+ * @Author: Mehdi
+ *
+ * @Params	total (Out): Slots of the memory, 0 before SIM900Storage; may be NULL
+ * @Return  Occupied slots
+*/
+
+uint8_t SIM900StorageUsed(uint8_t *total)
+{
+    if (total)
+        *total = SIM900_store_total;
+
+    return SIM900_store_used;
+}
+
+
+/**
+ * Name: SIM900NextMsg
+ * Description: The function finds the next occupied slot in the map. Recovery after a
+ *              restart or a lost +CMTI reads just these slots, no AT+CMGR probing.
+ * @Author: Mehdi
+ *
+ * @Params	from: First slot to look at, 1 for all
+ * @Params	id (Out): The slot found
+ * @Return  SIM900_OK, SIM900_MSG_EMPTY if no slot from there on is occupied
+*/
+
+int8_t SIM900NextMsg(uint8_t from, uint8_t *id)
+{
+    uint8_t slot;
+
+    if (from == 0)
+        from = 1;
+
+    for (slot = from - 1; slot < SIM900_store_total; slot++)
+    {
+        if (SIM900_store[slot >> 3] == 0)
+        {
+            slot |= 7;      // Skip the empty byte
+            continue;
+        }
+
+        if (SIM900_store[slot >> 3] & (1 << (slot & 7)))
+        {
+            *id = slot + 1;
+            return SIM900_OK;
+        }
+    }
+
+    return SIM900_MSG_EMPTY;
+}
+
+
+/**
+ * Name: SIM900StorageTask
+ * Description: The function keeps the memory from filling up, which makes the module
+ *              refuse new messages. It is meant to be called from the idle loop; once
+ *              SIM900_STORE_PURGE percent of the slots are occupied the read messages
+ *              are deleted (AT+CMGDA="DEL READ") and the map is rebuilt. If unread
+ *              messages alone keep it above the threshold, the next purge waits for
+ *              one more message.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_OK: purged, SIM900_FAIL: nothing to do, or the error of the purge
+*/
+
+int8_t SIM900StorageTask()
+{
+    uint8_t threshold = (uint16_t)SIM900_store_total * SIM900_STORE_PURGE / 100;
+    int8_t response;
+
+    if (SIM900_store_total == 0)
+        return SIM900_FAIL;
+
+    if (threshold == 0)
+        threshold = 1;
+
+    if (SIM900_store_used < threshold)
+        SIM900_store_limit = threshold;
+
+    if (SIM900_store_used < SIM900_store_limit)
+        return SIM900_FAIL;
+
+    if (UARTAvailable(&SIM900_UART))
+        return SIM900_FAIL;     // Let the caller read it first
+
+    SIM900Drain();
+
+    SIM900CmdF(PSTR("AT+CMGDA=\"DEL READ\""));
+
+    response = SIM900Result(SIM900WaitOK(SIM900_LIST_TIMEOUT));
+
+    if (response == SIM900_OK)
+        response = SIM900StorageScan();
+
+    // Purge again only once it grows further
+    SIM900_store_limit = (SIM900_store_used < threshold) ? threshold : SIM900_store_used + 1;
+
+    return response;
+}
+
+
+/**
+ * Name: SIM900DeliveryAdd
+ * Description: The function starts tracking a sent message in the slot of its <mr>. A
+ *              message still waiting there is given up and counted as lost.
+ * @Author: Mehdi
+ *
+ * @Params	num: Destination
+ * @Params	ref: <mr> of the message
+*/
+
+static void SIM900DeliveryAdd(const char *num, uint8_t ref)
+{
+    SIM900Delivery *d = &SIM900_dlr[ref & (SIM900_DLR_SLOTS - 1)];
+
+    if (d->status == SIM900_DLR_PENDING)
+        SIM900_dlr_stats.lost++;
+
+    d->ref = ref;
+    d->status = SIM900_DLR_PENDING;
+    d->st = 0xFF;
+    d->sent = SIM900Clock();
+    d->delay = 0;
+
+    strncpy(d->num,num,sizeof(d->num) - 1);
+    d->num[sizeof(d->num) - 1] = '\0';
+
+    SIM900_dlr_stats.sent++;
+}
+
+
+/**
+ * Name: SIM900SendMsg
+ * Description: The function send a given message  to given phone number via the module, then return message returned.
+ *              The body goes out once the module shows the "> " prompt, as fast as the
+ *              transmit ring drains, and ends with Ctrl-Z. The module then has
+ *              SIM900_SEND_TIMEOUT, counted from the prompt, to answer +CMGS: <mr>;
+ *              on a timeout the entry is cancelled with ESC.
+ *              The message is then tracked until its status report (SIM900GetDelivery).
+ * @Author: Mehdi
+ *
+ * @Params	num (In): Phone number to which the message send ex "+919XXXXXXX"
+ * @Params	msg (In): Message Body ex "This a message body"
+ * @Params  msg_ref (Out): After successful send, the function stores a unique message reference in this variable.
+ * @Return  SIM900_OK, SIM900_FAIL if the module refused the message, SIM900_TIMEOUT
+*/
+
+int8_t SIM900SendMsg(const char *num, const char *msg, uint8_t *msg_ref)
+{
+    char cmd[32];
+    uint16_t start, ticks = TICKS_MS(SIM900_SEND_TIMEOUT);
+    uint16_t elapsed;
+    int8_t response;
+    char c;
+
+    SIM900Drain();     // Clear pending data in queue
+
+    char *p = FmtStrF(cmd,cmd + sizeof(cmd) - 1,PSTR("AT+CMGS=\""));    // AT+CMGS="+919XXXXXXX"
+
+    p = FmtStr(p,cmd + sizeof(cmd) - 1,num);
+
+    char *q = FmtChar(p,cmd + sizeof(cmd) - 1,'"');
+
+    if (q == p)
+        return SIM900_FAIL;     // Number too long, no room left for the closing quote
+
+    *q = '\0';
+
+    SIM900Cmd(cmd);     // Send the command
+
+    response = SIM900WaitPrompt(SIM900_CMD_TIMEOUT);
+
+    if (response != SIM900_OK)
+        return SIM900Result(response);
+
+    start = TickNow();
+
+    // Body and Ctrl-Z, a port held by CTS for too long gives up
+    do
+    {
+        c = *msg ? *msg : 0x1A;
+
+        while (UARTTxRoom(&SIM900_UART) == 0)
+        {
+            if ((uint16_t)(TickNow() - start) >= ticks)
+            {
+                SIM900CancelEntry();
+                return SIM900Result(SIM900_TIMEOUT);
+            }
+
+            wdt_reset();
+        }
+
+        UARTPutc(&SIM900_UART,c);
+    } while (*msg++);
+
+    // An echo of the body may come first, then the result
+    while ((elapsed = TickNow() - start) < ticks)
+    {
+        if (SIM900Line(ticks - elapsed) == 0)
+            break;
+
+        if (SIM900_line == SIM900_LINE_CMGS)
+        {
+            *msg_ref = FmtNum(SIM900_buffer+7);
+
+            SIM900DeliveryAdd(num,*msg_ref);
+
+            SIM900WaitOK(SIM900_CMD_TIMEOUT);   // Trailing OK
+
+            return SIM900Result(SIM900_OK);
+        }
+
+        if (SIM900IsError(SIM900_line))
+            return SIM900Result(SIM900_FAIL);
+    }
+
+    SIM900CancelEntry();    // In case the Ctrl-Z did not get through
+
+    return SIM900Result(SIM900_TIMEOUT);
+}
+
+
+/**
+ * Name: SIM900GetDelivery
+ * Description: The function copies the delivery state of a sent message, no command is sent.
+ * @Author: Mehdi
+ *
+ * @Params	msg_ref: <mr> returned by SIM900SendMsg
+ * @Params	d (Out): Destination, send time, status and time to the final report
+ * @Return  SIM900_OK, SIM900_FAIL if the message is not tracked (any more)
+*/
+
+int8_t SIM900GetDelivery(uint8_t msg_ref, SIM900Delivery *d)
+{
+    SIM900Delivery *slot = &SIM900_dlr[msg_ref & (SIM900_DLR_SLOTS - 1)];
+
+    if (slot->status == SIM900_DLR_NONE || slot->ref != msg_ref)
+        return SIM900_FAIL;
+
+    *d = *slot;
+
+    return SIM900_OK;
+}
+
+
+/**
+ * Name: SIM900GetDeliveryStats
+ * Description: The function copies the delivery counters and the time to delivery figures.
+ * @Author: Mehdi
+ *
+ * @Params	stats (Out): The statistics
+*/
+
+void SIM900GetDeliveryStats(SIM900DeliveryStats *stats)
+{
+    *stats = SIM900_dlr_stats;
+}
+
+
+/**
+ * Name: SIM900DeliveryFormat
+ * Description: The function writes the delivery statistics as text, messages still waiting
+ *              for a report included, and min/avg/max time to delivery in seconds,
+ *              ex "DLR sent:12 ok:10 fail:1 lost:0 wait:1 t:4/9/31"
+ * @Author: Mehdi
+ *
+ * @Params	buf (Out): Output buffer
+ * @Params	size: Size of the buffer
+ * @Return  Length of the text
+*/
+
+uint8_t SIM900DeliveryFormat(char *buf, uint8_t size)
+{
+    const SIM900DeliveryStats *s = &SIM900_dlr_stats;
+    uint8_t i, wait = 0;
+    char *p = buf, *end = buf + size - 1;
+
+    for (i = 0; i < SIM900_DLR_SLOTS; i++)
+    {
+        if (SIM900_dlr[i].status == SIM900_DLR_PENDING)
+            wait++;
+    }
+
+    p = SIM900FmtField(p,end,PSTR("DLR sent:"),s->sent);
+    p = SIM900FmtField(p,end,PSTR(" ok:"),s->delivered);
+    p = SIM900FmtField(p,end,PSTR(" fail:"),s->failed);
+    p = SIM900FmtField(p,end,PSTR(" lost:"),s->lost);
+    p = SIM900FmtField(p,end,PSTR(" wait:"),wait);
+    p = SIM900FmtField(p,end,PSTR(" t:"),s->delay_min);
+    p = SIM900FmtField(p,end,PSTR("/"),s->delivered ? (uint16_t)(s->delay_sum / s->delivered) : 0);
+    p = SIM900FmtField(p,end,PSTR("/"),s->delay_max);
+    *p = '\0';
+
+    return p - buf;
+}
+
+
+/**
+ * Name: SIM900LivenessStep
+ * Description: The function takes the next recovery step after a ping went unanswered:
+ *              flush the port and send ESC (a message body the module still waits for
+ *              is abandoned), then restart the module with AT+CFUN=1,1, then power
+ *              cycle it with PWRKEY, which is repeated until the module comes back.
+ *              Each step is counted and logged in the trace.
+ * @Author: Mehdi
+ *
+ * @Params	now: SIM900Clock
+*/
+
+static void SIM900LivenessStep(uint16_t now)
+{
+    if (SIM900_live_step < SIM900_LIVE_POWER)
+        SIM900_live_step++;
+
+    if (SIM900_live_count[SIM900_live_step - 1] < 255)
+        SIM900_live_count[SIM900_live_step - 1]++;
+
+    SIM900TraceReset(SIM900_live_step);
+
+    // Next ping soon, not after a whole idle period
+    SIM900_live_at = now - (SIM900_PING_IDLE - SIM900_PING_RETRY);
+
+    SIM900_held = 0;
+    UARTFlush(&SIM900_UART);
+
+    switch (SIM900_live_step)
+    {
+        case SIM900_LIVE_FLUSH:
+            UARTPutc(&SIM900_UART,0x1B);
+            break;
+
+        case SIM900_LIVE_CFUN:
+            SIM900CmdF(PSTR("AT+CFUN=1,1"));   // Answers OK, then restarts
+            SIM900BootBegin(SIM900_BOOT_WAIT);
+            break;
+
+        default:
+            SIM900_PWRKEY_PRESS();
+            SIM900BootBegin(SIM900_BOOT_OFF);
+            break;
+    }
+}
+
+
+/**
+ * Name: SIM900LivenessTask
+ * Description: The function supervises the module. It is meant to be called from the
+ *              idle loop with the AVR watchdog enabled. Any line from the module proves
+ *              it alive; after SIM900_PING_IDLE seconds of silence it is pinged with AT.
+ *              An unanswered ping takes the next recovery step (SIM900LivenessStep),
+ *              SIM900_PING_RETRY seconds later it is pinged again. A restart is carried
+ *              on by SIM900BootTask over the next calls and ends with SIM900Init.
+ *              SIM900_SIM_ERRORS SIM errors in a row restart the module with AT+CFUN=1,1
+ *              as well, once until a SIM command succeeds again.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_BUSY: a recovery step was taken, SIM900_OK: the module answered or came
+ *          back, SIM900_FAIL: nothing to do or a restart in progress
+*/
+
+int8_t SIM900LivenessTask()
+{
+    uint16_t now = SIM900Clock();
+    int8_t response;
+
+    if (SIM900_boot != SIM900_BOOT_IDLE)
+    {
+        response = SIM900BootTask();
+
+        if (response == SIM900_BUSY)
+            return SIM900_FAIL;
+
+        if (response == SIM900_OK && SIM900Init() == SIM900_OK)
+        {
+            SIM900_heard = FALSE;
+            SIM900_live_at = now;
+            SIM900_live_step = SIM900_LIVE_OK;
+
+            return SIM900_OK;
+        }
+
+        SIM900LivenessStep(now);
+
+        return SIM900_BUSY;
+    }
+
+    if (SIM900_heard)
+    {
+        SIM900_heard = FALSE;
+        SIM900_live_at = now;
+        SIM900_live_step = SIM900_LIVE_OK;
+    }
+
+    if (SIM900_sim_errs >= SIM900_SIM_ERRORS && !SIM900_sim_reset && SIM900_live_step == SIM900_LIVE_OK)
+    {
+        SIM900_sim_errs = 0;
+        SIM900_sim_reset = TRUE;
+        SIM900_live_step = SIM900_LIVE_FLUSH;  // The next step is the restart
+
+        SIM900LivenessStep(now);
+
+        return SIM900_BUSY;
+    }
+
+    if ((uint16_t)(now - SIM900_live_at) < SIM900_PING_IDLE)
+        return SIM900_FAIL;
+
+    if (UARTAvailable(&SIM900_UART))
+        return SIM900_FAIL;     // Let the caller read it first
+
+    SIM900Drain();
+
+    SIM900CmdF(PSTR("AT"));
+
+    if (SIM900Result(SIM900WaitOK(SIM900_CMD_TIMEOUT)) == SIM900_OK)
+    {
+        SIM900_heard = FALSE;
+        SIM900_live_at = now;
+        SIM900_live_step = SIM900_LIVE_OK;
+
+        return SIM900_OK;
+    }
+
+    SIM900LivenessStep(now);
+
+    return SIM900_BUSY;
+}
+
+
+/**
+ * Name: SIM900LivenessState
+ * Description: The function returns the recovery step the supervisor took last.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_LIVE_OK while the module answers, SIM900_LIVE_xxx during a recovery
+*/
+
+uint8_t SIM900LivenessState()
+{
+    return SIM900_live_step;
+}
+
+
+/**
+ * Name: SIM900LivenessFormat
+ * Description: The function writes the supervisor state as text, the current step and the
+ *              recovery steps taken so far, ex "LIVE step:0 flush:2 cfun:1 power:0"
+ * @Author: Mehdi
+ *
+ * @Params	buf (Out): Output buffer
+ * @Params	size: Size of the buffer
+ * @Return  Length of the text
+*/
+
+uint8_t SIM900LivenessFormat(char *buf, uint8_t size)
+{
+    char *p = buf, *end = buf + size - 1;
+
+    p = SIM900FmtField(p,end,PSTR("LIVE step:"),SIM900_live_step);
+    p = SIM900FmtField(p,end,PSTR(" flush:"),SIM900_live_count[0]);
+    p = SIM900FmtField(p,end,PSTR(" cfun:"),SIM900_live_count[1]);
+    p = SIM900FmtField(p,end,PSTR(" power:"),SIM900_live_count[2]);
+    *p = '\0';
+
+    return p - buf;
+}
+
+
+/**
+ * Name: SIM900SignalTask
+ * Description: The function samples the signal quality with AT+CSQ every sampling period.
+ *              It is meant to be called from the idle loop, it returns at once when no
+ *              sample is due or when the module is sending something.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_OK: a sample was taken, SIM900_FAIL: nothing to do, or the error of AT+CSQ
+*/
+
+int8_t SIM900SignalTask()
+{
+    SIM900Clock();      // Keep the seconds of the delivery reports running
+
+    // Count whole seconds, the tick counter wraps every 65 s
+    while ((uint16_t)(TickNow() - SIM900_csq_tick) >= TICK_HZ)
+    {
+        SIM900_csq_tick += TICK_HZ;
+        SIM900_csq_secs++;
+    }
+
+    if (SIM900_csq_period == 0 || SIM900_csq_secs < SIM900_csq_period)
+        return SIM900_FAIL;
+
+    if (UARTAvailable(&SIM900_UART))
+        return SIM900_FAIL;     // Let the caller read it first, sample on the next call
+
+    SIM900_csq_secs = 0;
+
+    if (SIM900CmdF(PSTR("AT+CSQ")) != SIM900_OK)
+        return SIM900Result(SIM900_TIMEOUT);
+
+    // +CSQ is handled by SIM900Urc while waiting for OK
+    return SIM900Result(SIM900WaitOK(SIM900_CMD_TIMEOUT));
+}
+
+
+/**
+ * Name: SIM900SetSignalPeriod
+ * Description: The function sets the time between two AT+CSQ samples.
+ * @Author: Mehdi
+ *
+ * @Params	seconds: Sampling period, 0 stops sampling
+*/
+
+void SIM900SetSignalPeriod(uint16_t seconds)
+{
+    SIM900_csq_period = seconds;
+}
+
+
+/**
+ * Name: SIM900GetSignal
+ * Description: The function copies the cached signal quality, no command is sent.
+ * @Author: Mehdi
+ *
+ * @Params	sig (Out): Smoothed <rssi>, last <ber>, lowest and highest <rssi> seen and number of samples.
+ *                     <rssi> fields are 99 until the first sample.
+*/
+
+void SIM900GetSignal(SIM900Signal *sig)
+{
+    *sig = SIM900_signal;
+}
+
+
+/**
+ * Name: SIM900SignalBars
+ * Description: The function maps the smoothed <rssi> onto 0..4 signal bars.
+ *              <rssi> 2 is -109 dBm and every step is 2 dB.
+ * @Author: Mehdi
+ *
+ * @Return  0: no or unknown signal (< -109 dBm), 1: -109..-95 dBm, 2: -93..-85 dBm,
+ *          3: -83..-75 dBm, 4: -73 dBm and better
+*/
+
+uint8_t SIM900SignalBars()
+{
+    uint8_t rssi = SIM900_signal.rssi;
+
+    if (rssi == SIM900_CSQ_UNKNOWN || rssi < 2)
+        return 0;
+    if (rssi < 10)
+        return 1;
+    if (rssi < 15)
+        return 2;
+    if (rssi < 20)
+        return 3;
+
+    return 4;
+}
+
+
+/**
+ * Name: SIM900SignalFormat
+ * Description: The function writes the cached signal quality as text, ex "CSQ:18,0 min:12 max:21 n:40"
+ * @Author: Mehdi
+ *
+ * @Params	buf (Out): Output buffer
+ * @Params	size: Size of the buffer
+ * @Return  Length of the text
+*/
+
+uint8_t SIM900SignalFormat(char *buf, uint8_t size)
+{
+    char *p = buf, *end = buf + size - 1;
+
+    p = SIM900FmtField(p,end,PSTR("CSQ:"),SIM900_signal.rssi);
+    p = SIM900FmtField(p,end,PSTR(","),SIM900_signal.ber);
+    p = SIM900FmtField(p,end,PSTR(" min:"),SIM900_signal.rssi_min);
+    p = SIM900FmtField(p,end,PSTR(" max:"),SIM900_signal.rssi_max);
+    p = SIM900FmtField(p,end,PSTR(" n:"),SIM900_signal.samples);
+    *p = '\0';
+
+    return p - buf;
+}
+
+
+/**
+ * Name: SIM900GprsUp
+ * Description: The function brings the GPRS bearer up: any previous context is shut,
+ *              the APN is set (AT+CSTT), the bearer is activated (AT+CIICR) and the
+ *              local address is read (AT+CIFSR), which the module requires before a
+ *              connection can be opened.
+ * @Author: Mehdi
+ *
+ * @Params	apn: Access point name, ex "mcinet"
+ * @Return  SIM900_OK, SIM900_FAIL, SIM900_TIMEOUT
+*/
+
+static int8_t SIM900GprsUp(const char *apn)
+{
+    char cmd[40], *p, *end = cmd + sizeof(cmd) - 1;
+    int8_t response;
+
+    SIM900Drain();
+
+    SIM900CmdF(PSTR("AT+CIPSHUT"));    // Back to IP INITIAL, answers SHUT OK
+
+    do
+    {
+        if (SIM900Line(TICKS_MS(SIM900_CMD_TIMEOUT)) == 0)
+            return SIM900Result(SIM900_TIMEOUT);
+
+        if (SIM900IsError(SIM900_line))
+            return SIM900Result(SIM900_FAIL);
+    } while (strcmp_P(SIM900_buffer,PSTR("SHUT OK")) != 0);
+
+    SIM900Result(SIM900_OK);
+
+    p = FmtStrF(cmd,end,PSTR("AT+CSTT=\""));
+    p = FmtStr(p,end,apn);
+    p = FmtChar(p,end,'"');
+    *p = '\0';
+    SIM900Cmd(cmd);
+
+    response = SIM900Result(SIM900WaitOK(SIM900_CMD_TIMEOUT));
+
+    if (response != SIM900_OK)
+        return response;
+
+    SIM900CmdF(PSTR("AT+CIICR"));
+
+    response = SIM900Result(SIM900WaitOK(SIM900_GPRS_TIMEOUT));
+
+    if (response != SIM900_OK)
+        return response;
+
+    SIM900CmdF(PSTR("AT+CIFSR"));      // Answers with the address only, no OK
+
+    if (SIM900Line(TICKS_MS(SIM900_CMD_TIMEOUT)) == 0)
+        return SIM900Result(SIM900_TIMEOUT);
+
+    if (SIM900IsError(SIM900_line))
+        return SIM900Result(SIM900_FAIL);
+
+    SIM900_gprs = TRUE;
+
+    return SIM900Result(SIM900_OK);
+}
+
+
+/**
+ * Name: SIM900TcpOpen
+ * Description: The function opens a TCP connection, bringing the GPRS bearer up first
+ *              if it is down. An open connection is kept.
+ * @Author: Mehdi
+ *
+ * @Params	apn: Access point name
+ * @Params	host: Server name or address
+ * @Params	port: Server port
+ * @Return  SIM900_OK: connected, SIM900_FAIL: the bearer or the connection was refused,
+ *          SIM900_TIMEOUT
+*/
+
+int8_t SIM900TcpOpen(const char *apn, const char *host, uint16_t port)
+{
+    char cmd[64], *p, *end = cmd + sizeof(cmd) - 1;
+    uint16_t start, ticks = TICKS_MS(SIM900_TCP_TIMEOUT);
+    uint16_t elapsed;
+    int8_t response;
+
+    if (SIM900_tcp == SIM900_TCP_CONNECTED)
+        return SIM900_OK;
+
+    if (!SIM900_gprs)
+    {
+        response = SIM900GprsUp(apn);
+
+        if (response != SIM900_OK)
+            return response;
+    }
+
+    SIM900Drain();
+
+    p = FmtStrF(cmd,end,PSTR("AT+CIPSTART=\"TCP\",\""));
+    p = FmtStr(p,end,host);
+    p = FmtStrF(p,end,PSTR("\",\""));
+    p = FmtU16(p,end,port);
+    p = FmtChar(p,end,'"');
+    *p = '\0';
+    SIM900Cmd(cmd);
+
+    // OK comes at once, CONNECT OK or CONNECT FAIL when the connection is done
+    start = TickNow();
+
+    while ((elapsed = TickNow() - start) < ticks)
+    {
+        if (SIM900Line(ticks - elapsed) == 0)
+            break;
+
+        if (strcmp_P(SIM900_buffer,PSTR("CONNECT OK")) == 0 || strcmp_P(SIM900_buffer,PSTR("ALREADY CONNECT")) == 0)
+        {
+            SIM900_tcp = SIM900_TCP_CONNECTED;
+            return SIM900Result(SIM900_OK);
+        }
+
+        if (strcmp_P(SIM900_buffer,PSTR("CONNECT FAIL")) == 0 || SIM900IsError(SIM900_line))
+        {
+            SIM900_gprs = FALSE;    // Start over with a fresh bearer next time
+            return SIM900Result(SIM900_FAIL);
+        }
+    }
+
+    SIM900_gprs = FALSE;
+
+    return SIM900Result(SIM900_TIMEOUT);
+}
+
+
+/**
+ * Name: SIM900TcpSend
+ * Description: The function sends data over the open connection (AT+CIPSEND) and
+ *              waits until the module has sent it. The data has to be taken by the
+ *              transmit ring and SEND OK has to come within SIM900_TCP_SEND_TIMEOUT,
+ *              counted from the prompt. Data the ring did not take in time is cancelled
+ *              with ESC.
+ * @Author: Mehdi
+ *
+ * @Params	data: Data to send, need not be a string
+ * @Params	len: Length of data, at most 1460 byte
+ * @Return  SIM900_OK: SEND OK, SIM900_FAIL: SEND FAIL, an error, or no connection,
+ *          SIM900_TIMEOUT
+*/
+
+int8_t SIM900TcpSend(const char *data, uint16_t len)
+{
+    char cmd[20], *p;
+    uint16_t start, ticks = TICKS_MS(SIM900_TCP_SEND_TIMEOUT);
+    uint16_t elapsed;
+    int8_t response;
+
+    if (SIM900_tcp != SIM900_TCP_CONNECTED)
+        return SIM900_FAIL;
+
+    SIM900Drain();
+
+    p = FmtStrF(cmd,cmd + sizeof(cmd) - 1,PSTR("AT+CIPSEND="));
+    *FmtU16(p,cmd + sizeof(cmd) - 1,len) = '\0';
+    SIM900Cmd(cmd);
+
+    response = SIM900WaitPrompt(SIM900_CMD_TIMEOUT);
+
+    if (response != SIM900_OK)
+        return SIM900Result(response);
+
+    start = TickNow();
+
+    // A port held by CTS for too long gives up
+    while (len--)
+    {
+        while (UARTTxRoom(&SIM900_UART) == 0)
+        {
+            if ((uint16_t)(TickNow() - start) >= ticks)
+            {
+                SIM900CancelEntry();
+                return SIM900Result(SIM900_TIMEOUT);
+            }
+
+            wdt_reset();
+        }
+
+        UARTPutc(&SIM900_UART,*data++);
+    }
+
+    // An echo of the data may come first, then the result
+    while ((elapsed = TickNow() - start) < ticks)
+    {
+        if (SIM900Line(ticks - elapsed) == 0)
+            break;
+
+        if (strcmp_P(SIM900_buffer,PSTR("SEND OK")) == 0)
+            return SIM900Result(SIM900_OK);
+
+        if (strcmp_P(SIM900_buffer,PSTR("SEND FAIL")) == 0 || SIM900IsError(SIM900_line))
+            return SIM900Result(SIM900_FAIL);
+
+        if (SIM900_tcp != SIM900_TCP_CONNECTED)
+            return SIM900Result(SIM900_FAIL);   // CLOSED meanwhile
+    }
+
+    return SIM900Result(SIM900_TIMEOUT);
+}
+
+
+/**
+ * Name: SIM900TcpClose
+ * Description: The function closes the connection, the GPRS bearer stays up.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_OK, SIM900_FAIL, SIM900_TIMEOUT
+*/
+
+int8_t SIM900TcpClose()
+{
+    if (SIM900_tcp != SIM900_TCP_CONNECTED)
+        return SIM900_OK;
+
+    SIM900Drain();
+
+    SIM900CmdF(PSTR("AT+CIPCLOSE"));   // Answers CLOSE OK
+
+    SIM900_tcp = SIM900_TCP_CLOSED;
+
+    while (SIM900Line(TICKS_MS(SIM900_CMD_TIMEOUT)))
+    {
+        if (strcmp_P(SIM900_buffer,PSTR("CLOSE OK")) == 0)
+            return SIM900Result(SIM900_OK);
+
+        if (SIM900IsError(SIM900_line))
+            return SIM900Result(SIM900_FAIL);
+    }
+
+    return SIM900Result(SIM900_TIMEOUT);
+}
+
+
+/**
+ * Name: SIM900TcpState
+ * Description: The function returns the connection state, as kept from the module's
+ *              answers and the CLOSED and +PDP: DEACT URCs; no command is sent.
+ * @Author: Mehdi
+ *
+ * @Return  SIM900_TCP_CLOSED, SIM900_TCP_CONNECTED
+*/
+
+uint8_t SIM900TcpState()
+{
+    return SIM900_tcp;
 }
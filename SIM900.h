@@ -7,6 +7,7 @@
 
 //Error List
 #define SIM900_OK					 1
+#define SIM900_BUSY					 0	// Boot still in progress
 #define SIM900_INVALID_RESPONSE		-1
 #define SIM900_FAIL					-2
 #define SIM900_TIMEOUT				-3
@@ -18,22 +19,169 @@
 #define SIM900_NW_ERROR				99
 #define SIM900_SIM_NOT_READY		100
 #define SIM900_MSG_EMPTY			101
+#define SIM900_MSG_DUPLICATE		102	// Copy of a message read before (SIM900ReadMsg)
 
 #define SIM900_SIM_PRESENT			1
 #define SIM900_SIM_NOT_PRESENT		0
 
+//Readiness URCs seen during boot (SIM900BootReady)
+#define SIM900_READY_RDY			0x01	// RDY, only sent with a fixed baud rate
+#define SIM900_READY_CFUN			0x02	// +CFUN: 1
+#define SIM900_READY_CPIN			0x04	// +CPIN: READY
+#define SIM900_READY_CALL			0x08	// Call Ready
+#define SIM900_READY_ALL			(SIM900_READY_CPIN | SIM900_READY_CALL)
+
+//Command Classes (trace and statistics)
+#define SIM900_CMD_AT				0
+#define SIM900_CMD_CREG				1
+#define SIM900_CMD_CMGR				2
+#define SIM900_CMD_CMGD				3
+#define SIM900_CMD_CMGS				4
+#define SIM900_CMD_CMTI				5	// Incoming message URC
+#define SIM900_CMD_OTHER			6
+#define SIM900_CMD_CSQ				7	// Signal quality, not kept in the statistics
+#define SIM900_CMD_CIP				8	// GPRS and TCP, not kept in the statistics
+#define SIM900_CMD_CDS				9	// Status report URC, not kept in the statistics
+
+//TCP Connection State (SIM900TcpState)
+#define SIM900_TCP_CLOSED			0
+#define SIM900_TCP_CONNECTED		1
+
+//Liveness Supervisor Steps (SIM900LivenessTask)
+#define SIM900_LIVE_OK				0	// The module answers
+#define SIM900_LIVE_FLUSH			1	// Port flushed, ESC sent to end a stuck message body
+#define SIM900_LIVE_CFUN			2	// Module restarted with AT+CFUN=1,1
+#define SIM900_LIVE_POWER			3	// Module power cycled with PWRKEY
+
+#ifndef SIM900_PING_IDLE
+#define SIM900_PING_IDLE			30	// Seconds of silence on the link before an AT ping
+#endif
+#define SIM900_PING_RETRY			5	// Seconds from a recovery step to the next ping
+
+//Signal Quality
+#ifndef SIM900_CSQ_PERIOD
+#define SIM900_CSQ_PERIOD			60	// Seconds between AT+CSQ samples
+#endif
+
+typedef struct
+{
+	uint8_t		rssi;		// Smoothed <rssi> 0..31, 99 if not known
+	uint8_t		ber;		// Last <ber> 0..7, 99 if not known
+	uint8_t		rssi_min;	// Lowest <rssi> seen
+	uint8_t		rssi_max;	// Highest <rssi> seen
+	uint16_t	samples;	// Valid samples taken
+} SIM900Signal;
+
+//Message Reading
+#ifndef SIM900_CHUNK
+#define SIM900_CHUNK				16	// Body chars handed to a SIM900ReadMsgStream consumer at a time
+#endif
+
+// Consumer of a message body: gets the body in order, len chars (1..SIM900_CHUNK) at a
+// time, terminated. ctx is the pointer given to SIM900ReadMsgStream.
+typedef void (*SIM900BodyFn)(const char *chunk, uint8_t len, void *ctx);
+
+//Message Storage
+#ifndef SIM900_STORE_MAX
+#define SIM900_STORE_MAX			64	// Slots tracked, multiple of 8, larger memories are clipped
+#endif
+#ifndef SIM900_STORE_PURGE
+#define SIM900_STORE_PURGE			75	// Occupancy (%) at which read messages are purged
+#endif
+
+//Duplicate Suppression
+#ifndef SIM900_DUP_SETS
+#define SIM900_DUP_SETS				8	// Sets of 2 recent messages, power of two, 8 bytes each
+#endif
+
+//Delivery Reports
+#ifndef SIM900_DLR_SLOTS
+#define SIM900_DLR_SLOTS			8	// Messages tracked, power of two, picked by <mr>
+#endif
+
+#define SIM900_DLR_NONE				0	// Slot unused
+#define SIM900_DLR_PENDING			1	// Sent, no final status report yet
+#define SIM900_DLR_DELIVERED		2
+#define SIM900_DLR_FAILED			3
+
+//Error Classes (SIM900LastError), from the numeric codes of AT+CMEE=1
+#define SIM900_ERR_NONE				0	// The last command did not end with an error result
+#define SIM900_ERR_RETRY			1	// Transient, the command may be repeated at once
+#define SIM900_ERR_LATER			2	// Network, module or storage busy, repeat after a while
+#define SIM900_ERR_FATAL			3	// The request can not succeed as it is, do not repeat
+#define SIM900_ERR_SIM				4	// SIM missing, locked, failed or not ready
+
+#define SIM900_ERR_CME				0x8000	// Set in the code of a +CME ERROR, clear for +CMS ERROR
+#define SIM900_ERR_PLAIN			0xFFFF	// Code of an ERROR without a number
+
+#ifndef SIM900_SIM_ERRORS
+#define SIM900_SIM_ERRORS			3	// SIM errors in a row before the supervisor restarts the module
+#endif
+
+typedef struct
+{
+	uint8_t		ref;		// <mr> returned by AT+CMGS
+	uint8_t		status;		// SIM900_DLR_xxx
+	uint8_t		st;			// Last <st> (TP-Status) reported, 0xFF before any report
+	uint16_t	sent;		// Send time, seconds since power on
+	uint16_t	delay;		// Seconds from the send to the final report
+	char		num[16];	// Destination
+} SIM900Delivery;
+
+typedef struct
+{
+	uint16_t	sent;		// Messages sent with a report requested
+	uint16_t	delivered;
+	uint16_t	failed;
+	uint16_t	lost;		// Slots reused before the report came
+	uint16_t	delay_min;	// Time to delivery (s)
+	uint16_t	delay_max;
+	uint32_t	delay_sum;
+} SIM900DeliveryStats;
+
 //Low Level Functions
 int8_t SIM900Cmd(const char *cmd);
+int8_t SIM900CmdF(const char *cmd);
 
 //Public Interface
+void	SIM900BootStart();
+int8_t	SIM900BootTask();
+uint8_t	SIM900BootReady();
+uint16_t SIM900BootTime();
+uint8_t	SIM900BootFormat(char *, uint8_t);
 int8_t	SIM900Init();
+int8_t	SIM900Profile();
 int8_t	SIM900CheckResponse(const char *response,const char *check,uint8_t len);
 int8_t	SIM900WaitForResponse(uint16_t timeout);
 int8_t	SIM900GetNetStat();
+int8_t	SIM900NetStat();
+int8_t	SIM900WaitRegistered(uint16_t timeout);
 int8_t	SIM900DeleteMsg(uint8_t i);
 int8_t	SIM900WaitForMsg(uint8_t *);
 int8_t	SIM900ReadMsg(uint8_t i, char *);
+int8_t	SIM900ReadMsgStream(uint8_t i, SIM900BodyFn fn, void *ctx);
+int8_t	SIM900Storage();
+uint8_t	SIM900StorageUsed(uint8_t *total);
+int8_t	SIM900NextMsg(uint8_t from, uint8_t *id);
+int8_t	SIM900StorageTask();
 int8_t	SIM900SendMsg(const char *, const char *,uint8_t *);
+int8_t	SIM900GetDelivery(uint8_t msg_ref, SIM900Delivery *);
+void	SIM900GetDeliveryStats(SIM900DeliveryStats *);
+uint8_t	SIM900DeliveryFormat(char *, uint8_t);
+uint8_t	SIM900ErrorClass(uint16_t code);
+uint8_t	SIM900LastError(uint16_t *code);
+int8_t	SIM900LivenessTask();
+uint8_t	SIM900LivenessState();
+uint8_t	SIM900LivenessFormat(char *, uint8_t);
+int8_t	SIM900SignalTask();
+void	SIM900SetSignalPeriod(uint16_t seconds);
+void	SIM900GetSignal(SIM900Signal *);
+uint8_t	SIM900SignalBars();
+uint8_t	SIM900SignalFormat(char *, uint8_t);
+int8_t	SIM900TcpOpen(const char *apn, const char *host, uint16_t port);
+int8_t	SIM900TcpSend(const char *data, uint16_t len);
+int8_t	SIM900TcpClose();
+uint8_t	SIM900TcpState();
 
 
 
@@ -0,0 +1,132 @@
+/*
+ * Name: SIM900 Match
+ * Description: Pattern table and matcher of the module's result codes and URCs.
+                The table is sorted by byte value, so the patterns below a trie node are
+                a contiguous range of it and a step only moves the range ends inward.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "SIM900Match.h"
+
+
+#define SIM900_MATCH_LEN    13      // Longest pattern and its terminator
+#define SIM900_MATCH_EXACT  0x80    // The pattern is the whole line, not a prefix of it
+
+typedef struct
+{
+    char    text[SIM900_MATCH_LEN];
+    uint8_t cls;                    // SIM900_LINE_xxx, SIM900_MATCH_EXACT
+} SIM900Pattern;
+
+// Sorted by byte value ('+' < '>' < 'A'..'Z' < 'a'..'z'), keep it so when adding a pattern
+static const SIM900Pattern SIM900_patterns[] PROGMEM =
+{
+    { "+CCALR: 1",      SIM900_LINE_CALL   | SIM900_MATCH_EXACT },
+    { "+CDS: ",         SIM900_LINE_CDS },
+    { "+CFUN: 1",       SIM900_LINE_CFUN   | SIM900_MATCH_EXACT },
+    { "+CME ERROR:",    SIM900_LINE_CME },
+    { "+CMGS:",         SIM900_LINE_CMGS },
+    { "+CMS ERROR:",    SIM900_LINE_CMS },
+    { "+CMTI:",         SIM900_LINE_CMTI },
+    { "+CPIN: READY",   SIM900_LINE_CPIN   | SIM900_MATCH_EXACT },
+    { "+CREG: ",        SIM900_LINE_CREG },
+    { "+CSQ: ",         SIM900_LINE_CSQ },
+    { "+PDP: DEACT",    SIM900_LINE_DEACT  | SIM900_MATCH_EXACT },
+    { ">",              SIM900_LINE_PROMPT },
+    { "CLOSED",         SIM900_LINE_CLOSED | SIM900_MATCH_EXACT },
+    { "Call Ready",     SIM900_LINE_CALL   | SIM900_MATCH_EXACT },
+    { "ERROR",          SIM900_LINE_ERROR  | SIM900_MATCH_EXACT },
+    { "OK",             SIM900_LINE_OK     | SIM900_MATCH_EXACT },
+    { "RDY",            SIM900_LINE_RDY    | SIM900_MATCH_EXACT },
+    { "RING",           SIM900_LINE_RING   | SIM900_MATCH_EXACT },
+};
+
+#define SIM900_PATTERNS     (sizeof(SIM900_patterns) / sizeof(SIM900_patterns[0]))
+
+#define SIM900_PATTERN_CHAR(n,d)    ((uint8_t)pgm_read_byte(&SIM900_patterns[n].text[d]))
+#define SIM900_PATTERN_CLS(n)       pgm_read_byte(&SIM900_patterns[n].cls)
+
+
+/**
+ * Name: SIM900MatchStart
+ * Description: The function sets a matcher up for a new line.
+ * @Author: Mehdi
+ *
+ * @Params	m (Out): Matcher
+*/
+
+void SIM900MatchStart(SIM900Matcher *m)
+{
+    m->lo = 0;
+    m->hi = SIM900_PATTERNS;
+    m->depth = 0;
+    m->cls = SIM900_LINE_OTHER;
+}
+
+
+/**
+ * Name: SIM900MatchByte
+ * Description: The function takes the next byte of the line. The patterns whose byte at
+ *              this depth differs are dropped from both ends of the range; a prefix pattern
+ *              that ends here gives the class of the line whatever follows. Once the range
+ *              is empty a byte costs a compare.
+ * @Author: Mehdi
+ *
+ * @Params	m (In/Out): Matcher
+ * @Params	c: Byte received, not CR or LF
+ * @Return  SIM900_LINE_xxx of the prefix pattern matched so far, SIM900_LINE_OTHER if none
+*/
+
+uint8_t SIM900MatchByte(SIM900Matcher *m, char c)
+{
+    uint8_t d = m->depth;
+
+    if (c == '\0')
+        m->lo = m->hi;      // Not in any pattern, and it would match their terminators
+
+    if (m->lo >= m->hi)
+        return m->cls;
+
+    // A pattern that ended at the previous byte sorts first and drops here
+    while (m->lo < m->hi && SIM900_PATTERN_CHAR(m->lo,d) < (uint8_t)c)
+        m->lo++;
+
+    while (m->lo < m->hi && SIM900_PATTERN_CHAR(m->hi - 1,d) > (uint8_t)c)
+        m->hi--;
+
+    m->depth = ++d;
+
+    if (m->lo < m->hi && SIM900_PATTERN_CHAR(m->lo,d) == '\0')
+    {
+        uint8_t cls = SIM900_PATTERN_CLS(m->lo);
+
+        if (!(cls & SIM900_MATCH_EXACT))
+            m->cls = cls;
+    }
+
+    return m->cls;
+}
+
+
+/**
+ * Name: SIM900MatchEnd
+ * Description: The function gives the class of the line once its end arrived.
+ * @Author: Mehdi
+ *
+ * @Params	m (In): Matcher fed with the whole line
+ * @Return  SIM900_LINE_xxx
+*/
+
+uint8_t SIM900MatchEnd(const SIM900Matcher *m)
+{
+    if (m->lo < m->hi && SIM900_PATTERN_CHAR(m->lo,m->depth) == '\0')
+        return SIM900_PATTERN_CLS(m->lo) & ~SIM900_MATCH_EXACT;
+
+    return m->cls;
+}
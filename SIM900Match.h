@@ -0,0 +1,48 @@
+/*
+ * Name: SIM900 Match
+ * Description: Classifies the lines sent by the module while their bytes arrive. The result
+                codes and URC prefixes form a trie kept in flash as a sorted pattern table; a
+                matcher narrows the range of patterns sharing the bytes seen so far, so the
+                class of a line is known once its CR lands, without comparing it again.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef SIM900MATCH_H_
+#define SIM900MATCH_H_
+
+#include <stdint.h>
+
+// Line classes. The readiness URCs come first, in SIM900_READY_xxx bit order.
+#define SIM900_LINE_OTHER   0       // Anything else (intermediate results, message text)
+#define SIM900_LINE_RDY     1       // RDY
+#define SIM900_LINE_CFUN    2       // +CFUN: 1
+#define SIM900_LINE_CPIN    3       // +CPIN: READY
+#define SIM900_LINE_CALL    4       // Call Ready, +CCALR: 1
+#define SIM900_LINE_OK      5       // OK
+#define SIM900_LINE_ERROR   6       // ERROR
+#define SIM900_LINE_CMS     7       // +CMS ERROR: <err>
+#define SIM900_LINE_CME     8       // +CME ERROR: <err>
+#define SIM900_LINE_CMTI    9       // +CMTI: <mem>,<index>
+#define SIM900_LINE_CMGS    10      // +CMGS: <mr>
+#define SIM900_LINE_CREG    11      // +CREG: [<n>,]<stat>
+#define SIM900_LINE_CSQ     12      // +CSQ: <rssi>,<ber>
+#define SIM900_LINE_CDS     13      // +CDS: ...
+#define SIM900_LINE_CLOSED  14      // CLOSED
+#define SIM900_LINE_DEACT   15      // +PDP: DEACT
+#define SIM900_LINE_RING    16      // RING
+#define SIM900_LINE_PROMPT  17      // > (data prompt)
+
+typedef struct
+{
+    uint8_t lo;         // Patterns [lo, hi) share the bytes seen so far
+    uint8_t hi;
+    uint8_t depth;      // Bytes seen
+    uint8_t cls;        // Longest prefix pattern matched, SIM900_LINE_xxx
+} SIM900Matcher;
+
+void    SIM900MatchStart(SIM900Matcher *m);
+uint8_t SIM900MatchByte(SIM900Matcher *m, char c);
+uint8_t SIM900MatchEnd(const SIM900Matcher *m);
+
+#endif /* SIM900MATCH_H_ */
@@ -0,0 +1,260 @@
+/*
+ * Name: SIM900 Stats
+ * Description: Per command class counters and latency histograms of the modem exchanges.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+
+#include "Fmt.h"
+#include "SIM900.h"
+#include "SIM900Stats.h"
+
+
+static SIM900Stats SIM900_stats[SIM900_STATS_CLASSES];
+
+static const char class_name[SIM900_STATS_CLASSES][5] PROGMEM = { "AT", "CREG", "CMGR", "CMGD", "CMGS" };
+
+static uint16_t SIM900_duplicates;      // Redelivered messages dropped by SIM900ReadMsg
+static uint8_t  SIM900_errors[4];       // Error results per class, SIM900_ERR_RETRY .. SIM900_ERR_SIM
+
+
+/**
+ * Name: SIM900StatsResult
+ * Description: The function accounts the end of an exchange.
+ * @Author: Mehdi
+ *
+ * @Params	cmd: Command class, SIM900_CMD_xxx
+ * @Params	code: Return code of the exchange
+ * @Params	ticks: Latency of the exchange
+*/
+
+void SIM900StatsResult(uint8_t cmd, int8_t code, uint16_t ticks)
+{
+    if (cmd >= SIM900_STATS_CLASSES)
+        return;
+
+    SIM900Stats *s = &SIM900_stats[cmd];
+
+    if (s->count != UINT16_MAX)
+        s->count++;
+
+    if (code == SIM900_TIMEOUT)
+    {
+        if (s->timeouts != UINT8_MAX)
+            s->timeouts++;
+        return;
+    }
+
+    if (code == SIM900_FAIL || code == SIM900_INVALID_RESPONSE || code == SIM900_SIM_NOT_READY)
+    {
+        if (s->errors != UINT8_MAX)
+            s->errors++;
+    }
+
+    // Bucket is log2 of the latency, starting at 32 ms
+    uint8_t b = 0;
+
+    ticks >>= 5;
+    while (ticks && b < SIM900_HIST_BUCKETS - 1)
+    {
+        ticks >>= 1;
+        b++;
+    }
+
+    if (s->hist[b] != UINT8_MAX)
+        s->hist[b]++;
+}
+
+
+/**
+ * Name: SIM900StatsError
+ * Description: The function counts an error result by its class.
+ * @Author: Mehdi
+ *
+ * @Params	cls: SIM900_ERR_xxx
+*/
+
+void SIM900StatsError(uint8_t cls)
+{
+    if (cls < SIM900_ERR_RETRY || cls > SIM900_ERR_SIM)
+        return;
+
+    if (SIM900_errors[cls - SIM900_ERR_RETRY] != UINT8_MAX)
+        SIM900_errors[cls - SIM900_ERR_RETRY]++;
+}
+
+
+/**
+ * Name: SIM900StatsDuplicate
+ * Description: The function counts a redelivered message that was not acted on.
+ * @Author: Mehdi
+*/
+
+void SIM900StatsDuplicate(void)
+{
+    if (SIM900_duplicates != UINT16_MAX)
+        SIM900_duplicates++;
+}
+
+
+/**
+ * Name: SIM900StatsDuplicates
+ * Description: The function returns the number of redelivered messages dropped.
+ * @Author: Mehdi
+ *
+ * @Return  Duplicates since the last SIM900StatsClear
+*/
+
+uint16_t SIM900StatsDuplicates(void)
+{
+    return SIM900_duplicates;
+}
+
+
+/**
+ * Name: SIM900GetStats
+ * Description: The function copies the statistics of a command class.
+ * @Author: Mehdi
+ *
+ * @Params	cmd (In): Command class, SIM900_CMD_xxx
+ * @Params	stats (Out): Copy of the statistics
+ * @Return  SIM900_OK, or SIM900_FAIL for a class without statistics
+*/
+
+int8_t SIM900GetStats(uint8_t cmd, SIM900Stats *stats)
+{
+    if (cmd >= SIM900_STATS_CLASSES)
+        return SIM900_FAIL;
+
+    memcpy(stats, &SIM900_stats[cmd], sizeof(SIM900Stats));
+
+    return SIM900_OK;
+}
+
+
+/**
+ * Name: SIM900StatsAppend
+ * Description: The function appends a group to the status string, after a blank
+ *              separator unless the string is empty. A group that does not fit is
+ *              left out whole.
+ * @Author: Mehdi
+ *
+ * @Params	buf (In/Out): Status string
+ * @Params	len (In): Current length of buf
+ * @Params	size (In): Size of buf, including the terminator
+ * @Params	group (In): Group to append
+ * @Params	n (In): Length of group
+ * @Return  New length of buf, len unchanged if the group did not fit
+*/
+
+static uint8_t SIM900StatsAppend(char *buf, uint8_t len, uint8_t size, const char *group, uint8_t n)
+{
+    if (len + (len != 0) + n + 1 > size)
+        return len;
+
+    if (len)
+        buf[len++] = ' ';
+
+    strcpy(buf + len, group);
+
+    return len + n;
+}
+
+
+/**
+ * Name: SIM900StatsFormat
+ * Description: The function writes the statistics of the classes that have been used,
+ *              one "NAME:count,timeouts,errors:h0.h1.h2.h3.h4.h5.h6.h7" group per class,
+ *              separated by blanks, then "DUP:n" if duplicates were dropped and
+ *              "ERR:retry.later.fatal.sim" if error results came. It is meant for status
+ *              SMS replies.
+ * @Author: Mehdi
+ *
+ * @Params	buf (Out): Destination string
+ * @Params	size (In): Size of buf, including the terminator
+ * @Return  Length of the string written
+*/
+
+uint8_t SIM900StatsFormat(char *buf, uint8_t size)
+{
+    char group[64], *p, *end = group + sizeof(group) - 1;
+    uint8_t len = 0;
+
+    buf[0] = '\0';
+
+    for (uint8_t c = 0; c < SIM900_STATS_CLASSES; c++)
+    {
+        SIM900Stats *s = &SIM900_stats[c];
+
+        if (s->count == 0)
+            continue;
+
+        p = FmtStrF(group, end, class_name[c]);
+        p = FmtChar(p, end, ':');
+        p = FmtU16(p, end, s->count);
+        p = FmtChar(p, end, ',');
+        p = FmtU8(p, end, s->timeouts);
+        p = FmtChar(p, end, ',');
+        p = FmtU8(p, end, s->errors);
+
+        for (uint8_t b = 0; b < SIM900_HIST_BUCKETS; b++)
+        {
+            p = FmtChar(p, end, b ? '.' : ':');
+            p = FmtU8(p, end, s->hist[b]);
+        }
+
+        *p = '\0';
+
+        uint8_t next = SIM900StatsAppend(buf, len, size, group, p - group);
+
+        if (next == len)
+            break;
+
+        len = next;
+    }
+
+    if (SIM900_duplicates)
+    {
+        p = FmtStrF(group, end, PSTR("DUP:"));
+        *(p = FmtU16(p, end, SIM900_duplicates)) = '\0';
+
+        len = SIM900StatsAppend(buf, len, size, group, p - group);
+    }
+
+    if (SIM900_errors[0] | SIM900_errors[1] | SIM900_errors[2] | SIM900_errors[3])
+    {
+        p = FmtStrF(group, end, PSTR("ERR"));
+
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            p = FmtChar(p, end, i ? '.' : ':');
+            p = FmtU8(p, end, SIM900_errors[i]);
+        }
+
+        *p = '\0';
+
+        len = SIM900StatsAppend(buf, len, size, group, p - group);
+    }
+
+    return len;
+}
+
+
+/**
+ * Name: SIM900StatsClear
+ * Description: The function resets all statistics.
+ * @Author: Mehdi
+*/
+
+void SIM900StatsClear(void)
+{
+    memset(SIM900_stats, 0, sizeof(SIM900_stats));
+    SIM900_duplicates = 0;
+    memset(SIM900_errors, 0, sizeof(SIM900_errors));
+}
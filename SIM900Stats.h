@@ -0,0 +1,34 @@
+/*
+ * Name: SIM900 Stats
+ * Description: Per command class counters and latency histograms of the modem exchanges.
+                The SIM900 layer updates them at the end of every exchange, 12 bytes per class.
+                Counters saturate instead of wrapping.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef SIM900STATS_H_
+#define SIM900STATS_H_
+
+#include <stdint.h>
+
+#define SIM900_STATS_CLASSES    5       // SIM900_CMD_AT .. SIM900_CMD_CMGS
+#define SIM900_HIST_BUCKETS     8       // Bucket k: latency < (32 << k) ms, last bucket >= 2048 ms
+
+typedef struct
+{
+    uint16_t    count;                      // Exchanges
+    uint8_t     timeouts;                   // Exchanges ended with SIM900_TIMEOUT
+    uint8_t     errors;                     // Exchanges ended with an error from the modem
+    uint8_t     hist[SIM900_HIST_BUCKETS];  // Latency of the exchanges answered in time
+} SIM900Stats;
+
+void    SIM900StatsResult(uint8_t cmd, int8_t code, uint16_t ticks);
+void    SIM900StatsError(uint8_t cls);
+void    SIM900StatsDuplicate(void);
+uint16_t SIM900StatsDuplicates(void);
+int8_t  SIM900GetStats(uint8_t cmd, SIM900Stats *stats);
+uint8_t SIM900StatsFormat(char *buf, uint8_t size);
+void    SIM900StatsClear(void);
+
+#endif /* SIM900STATS_H_ */
@@ -0,0 +1,180 @@
+/*
+ * Name: SIM900 Trace
+ * Description: Storage and text output of the AT exchange trace ring.
+                Each record is printed as 10 hex digits "EECCRRTTTT" (event, command class,
+                return code, ticks), newest record first.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+
+#include "SIM900Trace.h"
+
+
+SIM900TraceRec  SIM900_trace[SIM900_TRACE_SIZE];
+uint8_t         SIM900_trace_pos;
+uint8_t         SIM900_trace_cmd;
+uint16_t        SIM900_trace_start;
+
+
+#define SIM900_TRACE_REC_LEN    11      // 10 hex digits and a separator
+
+static const char hex_digit[] PROGMEM = "0123456789ABCDEF";
+
+
+/**
+ * Name: SIM900TraceHex
+ * Description: The function writes a record as 10 hex digits.
+ * @Author: Mehdi
+ *
+ * @Params	buf (Out): Destination, at least 10 char
+ * @Params	r (In): Record to write
+*/
+
+static void SIM900TraceHex(char *buf, const SIM900TraceRec *r)
+{
+    uint8_t bytes[5] = { r->event, r->cmd, (uint8_t)r->code, r->ticks >> 8, r->ticks };
+
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        *buf++ = pgm_read_byte(&hex_digit[bytes[i] >> 4]);
+        *buf++ = pgm_read_byte(&hex_digit[bytes[i] & 0x0F]);
+    }
+}
+
+
+/**
+ * Name: SIM900TracePut
+ * Description: The function writes a record as a line of 10 hex digits and CR LF.
+ * @Author: Mehdi
+ *
+ * @Params	r (In): Record to write
+ * @Params	put (In): Character output
+*/
+
+static void SIM900TracePut(const SIM900TraceRec *r, void (*put)(char))
+{
+    char line[SIM900_TRACE_REC_LEN - 1];
+
+    SIM900TraceHex(line, r);
+
+    for (uint8_t i = 0; i < sizeof(line); i++)
+        put(line[i]);
+
+    put(0x0D);
+    put(0x0A);
+}
+
+
+/**
+ * Name: SIM900TraceFormat
+ * Description: The function writes as many records as fit in buf, newest first,
+ *              separated by blanks. It is meant for status SMS replies.
+ * @Author: Mehdi
+ *
+ * @Params	buf (Out): Destination string
+ * @Params	size (In): Size of buf, including the terminator
+ * @Return  Length of the string written
+*/
+
+uint8_t SIM900TraceFormat(char *buf, uint8_t size)
+{
+    uint8_t n = SIM900_TRACE_SIZE;
+    uint8_t pos = SIM900_trace_pos;
+    uint8_t len = 0;
+    SIM900TraceRec *r;
+
+    while (n-- && len + SIM900_TRACE_REC_LEN <= size)
+    {
+        r = &SIM900_trace[--pos & SIM900_TRACE_MASK];
+
+        if (r->event == 0)      // Never written
+            break;
+
+        SIM900TraceHex(buf + len, r);
+        len += SIM900_TRACE_REC_LEN - 1;
+        buf[len++] = ' ';
+    }
+
+    if (len)
+        len--;      // Drop the last separator
+
+    buf[len] = '\0';
+
+    return len;
+}
+
+
+/**
+ * Name: SIM900TraceDump
+ * Description: The function writes every record, newest first, one per line (CR LF).
+ * @Author: Mehdi
+ *
+ * @Params	put (In): Character output, e.g. a UART transmit function
+*/
+
+void SIM900TraceDump(void (*put)(char))
+{
+    uint8_t n = SIM900_TRACE_SIZE;
+    uint8_t pos = SIM900_trace_pos;
+    SIM900TraceRec *r;
+
+    while (n--)
+    {
+        r = &SIM900_trace[--pos & SIM900_TRACE_MASK];
+
+        if (r->event == 0)      // Never written
+            break;
+
+        SIM900TracePut(r, put);
+    }
+}
+
+
+/**
+ * Name: SIM900TraceStream
+ * Description: The function writes the records logged since a previous call, oldest
+ *              first, one per line. It lets a console follow the trace as it grows;
+ *              records already overwritten in the ring are skipped.
+ * @Author: Mehdi
+ *
+ * @Params	from (In): Position returned by the previous call, 0 the first time
+ * @Params	put (In): Character output
+ * @Return  Position to pass to the next call
+*/
+
+uint8_t SIM900TraceStream(uint8_t from, void (*put)(char))
+{
+    uint8_t pos = SIM900_trace_pos;
+
+    if ((uint8_t)(pos - from) > SIM900_TRACE_SIZE)
+        from = pos - SIM900_TRACE_SIZE;
+
+    while (from != pos)
+    {
+        SIM900TraceRec *r = &SIM900_trace[from++ & SIM900_TRACE_MASK];
+
+        if (r->event)       // Cleared since the previous call otherwise
+            SIM900TracePut(r, put);
+    }
+
+    return pos;
+}
+
+
+/**
+ * Name: SIM900TraceClear
+ * Description: The function empties the ring.
+ * @Author: Mehdi
+*/
+
+void SIM900TraceClear(void)
+{
+    memset(SIM900_trace, 0, sizeof(SIM900_trace));
+    SIM900_trace_pos = 0;
+}
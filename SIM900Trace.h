@@ -0,0 +1,102 @@
+/*
+ * Name: SIM900 Trace
+ * Description: In-RAM ring of the last AT exchanges for field diagnostics. The SIM900 layer
+                logs every command it sends and the result of every exchange as a 5 byte binary
+                record; logging is a handful of inline stores. The ring can be dumped as hex
+                text through any character output, streamed to a console as it grows, or
+                formatted into an SMS body.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef SIM900TRACE_H_
+#define SIM900TRACE_H_
+
+#include <stdint.h>
+
+#include "Tick.h"
+
+#ifndef SIM900_TRACE_SIZE
+    #define SIM900_TRACE_SIZE   32      // Number of records, must be a power of two
+#endif
+
+#define SIM900_TRACE_MASK       (SIM900_TRACE_SIZE - 1)
+
+#if SIM900_TRACE_SIZE & SIM900_TRACE_MASK
+    #error "SIM900_TRACE_SIZE must be a power of two"
+#endif
+
+//Events
+#define SIM900_TRACE_CMD        1   // Command sent,        ticks: time stamp
+#define SIM900_TRACE_RESULT     2   // Exchange finished,   ticks: latency since the command, code: return code
+#define SIM900_TRACE_URC        3   // Unsolicited result,  ticks: time stamp
+#define SIM900_TRACE_RESET      4   // Recovery step,       ticks: time stamp, cmd: SIM900_LIVE_xxx
+
+typedef struct
+{
+    uint8_t     event;      // SIM900_TRACE_xxx
+    uint8_t     cmd;        // Command class, SIM900_CMD_xxx
+    int8_t      code;       // SIM900_xxx return code, RESULT only
+    uint16_t    ticks;
+} SIM900TraceRec;
+
+extern SIM900TraceRec   SIM900_trace[SIM900_TRACE_SIZE];
+extern uint8_t          SIM900_trace_pos;      // Next record to write, not masked
+extern uint8_t          SIM900_trace_cmd;      // Class of the command in progress
+extern uint16_t         SIM900_trace_start;    // Time stamp of the command in progress
+
+
+static inline SIM900TraceRec *SIM900TraceNext(void)
+{
+    return &SIM900_trace[SIM900_trace_pos++ & SIM900_TRACE_MASK];
+}
+
+static inline void SIM900TraceCmd(uint8_t cmd)
+{
+    SIM900TraceRec *r = SIM900TraceNext();
+
+    SIM900_trace_cmd = cmd;
+    SIM900_trace_start = TickNow();
+
+    r->event = SIM900_TRACE_CMD;
+    r->cmd = cmd;
+    r->code = 0;
+    r->ticks = SIM900_trace_start;
+}
+
+static inline void SIM900TraceResult(int8_t code, uint16_t ticks)
+{
+    SIM900TraceRec *r = SIM900TraceNext();
+
+    r->event = SIM900_TRACE_RESULT;
+    r->cmd = SIM900_trace_cmd;
+    r->code = code;
+    r->ticks = ticks;
+}
+
+static inline void SIM900TraceUrc(uint8_t cmd)
+{
+    SIM900TraceRec *r = SIM900TraceNext();
+
+    r->event = SIM900_TRACE_URC;
+    r->cmd = cmd;
+    r->code = 0;
+    r->ticks = TickNow();
+}
+
+static inline void SIM900TraceReset(uint8_t step)
+{
+    SIM900TraceRec *r = SIM900TraceNext();
+
+    r->event = SIM900_TRACE_RESET;
+    r->cmd = step;
+    r->code = 0;
+    r->ticks = TickNow();
+}
+
+uint8_t SIM900TraceFormat(char *buf, uint8_t size);
+void    SIM900TraceDump(void (*put)(char));
+uint8_t SIM900TraceStream(uint8_t from, void (*put)(char));
+void    SIM900TraceClear(void);
+
+#endif /* SIM900TRACE_H_ */
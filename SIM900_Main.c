@@ -3,144 +3,343 @@
 #define F_CPU 7372800UL
 
 #include <avr/io.h>
+#include <avr/wdt.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
 
-#include "UART_4.h"
+#include "config.h"
+#include "UART.h"
 #include "LCD.h"
 #include "SIM900.h"
+#include "SIM900Trace.h"
+#include "SIM900Stats.h"
+#include "Telemetry.h"
+#include "Tick.h"
 #include "Gen_Def.h"
 
+#define OPERATOR_NUMBER "+989126824328"    // Receives test and diagnostic SMS
+#define STATS_REPORT_MIN 1440               // Period of the statistics SMS (minutes)
+
+#define TELEMETRY_APN   "mcinet"            // GPRS access point of the SIM operator
+#define TELEMETRY_HOST  "telemetry.example.com"
+#define TELEMETRY_PORT  5000
+
 
 void Halt(void);
+
+uint8_t reset_flags __attribute__((section(".noinit")));    // Reset cause flags of the last reset
+
+
+/**
+ * Name: SaveResetFlags
+ * Description: The function runs before main (.init3). It keeps the reset cause flags for
+ *              the log and stops the watchdog, which stays on after a watchdog reset.
+ * @Author: Mehdi
+*/
+
+void SaveResetFlags(void) __attribute__((naked, used, section(".init3")));
+
+void SaveResetFlags(void)
+{
+#if defined(MCUSR)
+    reset_flags = MCUSR;
+    MCUSR = 0;
+#else
+    reset_flags = MCUCSR;
+    MCUCSR = 0;
+#endif
+    wdt_disable();
+}
+
+
+/**
+ * Name: Pause
+ * Description: The function waits while the watchdog is kept fed, for the pauses longer
+ *              than its period.
+ * @Author: Mehdi
+ *
+ * @Params	ms: Time to wait (ms), a multiple of 100
+*/
+
+static void Pause(uint16_t ms)
+{
+    for (; ms >= 100; ms -= 100)
+    {
+        _delay_ms(100);
+        wdt_reset();
+    }
+}
+
+#if UART_PORTS > 1
+
+static uint8_t console_pos;     // Trace records already sent to the console
+
+static void ConsolePut(char c)
+{
+    UARTPutc(&CONSOLE_UART,c);
+}
+
+/**
+ * Name: ConsoleTask
+ * Description: The function streams new trace records to the diagnostics console and
+ *              answers its one letter commands: s statistics, q signal quality, b boot
+ *              times, d delivery reports, l modem supervisor, t whole trace, c clear trace
+ *              and statistics.
+ *              The modem port is not touched.
+ * @Author: Mehdi
+*/
+
+static void ConsoleTask(void)
+{
+    char buf[96];
+
+    console_pos = SIM900TraceStream(console_pos,ConsolePut);
+
+    switch (UARTGetc(&CONSOLE_UART))
+    {
+        case 's':
+            SIM900StatsFormat(buf,sizeof(buf));
+            break;
+        case 'q':
+            SIM900SignalFormat(buf,sizeof(buf));
+            break;
+        case 'b':
+            SIM900BootFormat(buf,sizeof(buf));
+            break;
+        case 'd':
+            SIM900DeliveryFormat(buf,sizeof(buf));
+            break;
+        case 'l':
+            SIM900LivenessFormat(buf,sizeof(buf));
+            break;
+        case 't':
+            SIM900TraceDump(ConsolePut);
+            return;
+        case 'c':
+            SIM900TraceClear();
+            SIM900StatsClear();
+            console_pos = 0;
+            return;
+        default:
+            return;
+    }
+
+    UARTPuts(&CONSOLE_UART,buf);
+    UARTPutsF(&CONSOLE_UART,PSTR("\r\n"));
+}
+
+#else
+    #define ConsoleTask()
+#endif
+
+
+static uint8_t recover_from = 1;    // Next slot of the recovery pass, 0 once it is over
+
+/**
+ * Name: NextMessage
+ * Description: The function returns the slot of the next message to handle. The messages
+ *              found in the storage map at boot (sent while the board was off, or whose
+ *              +CMTI got lost) come first, once; then it waits for new ones.
+ * @Author: Mehdi
+ *
+ * @Params	id (Out): Slot of the message
+ * @Return  SIM900_OK, or the result of SIM900WaitForMsg
+*/
+
+static int8_t NextMessage(uint8_t *id)
+{
+    if (recover_from && SIM900NextMsg(recover_from,id) == SIM900_OK)
+    {
+        recover_from = *id + 1;
+        return SIM900_OK;
+    }
+
+    recover_from = 0;
+
+    return SIM900WaitForMsg(id);
+}
+
+
 int main()
 {
-    char *Greeting_msg = "Hello World!";
     uint8_t id;     // Number of the slot where received message stores in
 
+    // Time base for the AT trace
+    TickInit();
 
-    // Initialize the UART; Baud Rate=9.6k, 8-byte data size,
+    // A hang anywhere resets the board, the modem waits feed it as they go
+    wdt_enable(WDTO_2S);
+
+    // Initialize the modem UART; Baud Rate=9.6k, 8-byte data size,
     // No parity, one stop bit, disable Double Speed in Asynchronization
-    USART_Initialization(9600,8,NONE,1,0);
+    UARTInit(&SIM900_UART,9600,8,NONE,1,0);
+
+#if UART_PORTS > 1
+    // Diagnostics console on the second USART
+    UARTInit(&CONSOLE_UART,38400,8,NONE,1,0);
+#endif
 
-    // Initialization of USART Interrupt (RXC, TXC, UDRE)
-    USART_Interrupt_Int(TRUE,FALSE,FALSE);
+    // Power the module on, it boots while the rest of the board is set up
+    SIM900BootStart();
 
     // Initialize LCD module, LCD Blink & Cursor is "underline" type
     LCDInit(LS_BLINK|LS_ULINE);
 
-    LCDWriteStringXY(4,1,Greeting_msg);
-    _delay_ms(5000);
-    LCDClear();
+    LCDWriteFStringXY(4,1,PSTR("Hello World!"));
 
     DDRB |= 1 << PINB1 | 1 << PINB2;
-    PORTB &= ~(1 << PINB1) | ~(1 << PINB2);
+    PORTB &= ~(1 << PINB1 | 1 << PINB2);
+
+    // The greeting stays until the module is ready
+    while (SIM900BootTask() == SIM900_BUSY)
+        wdt_reset();
+
+    LCDClear();
 
     // Initializing SIM900
-    LCDWriteString("Initializing SIM900");
+    LCDWriteFString(PSTR("Initializing SIM900"));
     int8_t response = SIM900Init();
 
-    _delay_ms(1000);
-
-    switch(r)
+    switch(response)
     {
         case SIM900_OK:
-            LCDWriteStringXY(0,1,"OK!");
+            // Time from power on to Call Ready
+            LCDPrintXY(0,1,LCD_F("OK! "),LCD_I(SIM900BootTime(),5),LCD_F("ms"));
             break;
         case SIM900_TIMEOUT:
-            LCDWriteStringXY(0,1,"No Response!");
+            LCDWriteFStringXY(0,1,PSTR("No Response!"));
             break;
         case SIM900_INVALID_RESPONSE:
-            LCDWriteStringXY(0,1,"Invalid Response!");
+            LCDWriteFStringXY(0,1,PSTR("Invalid Response!"));
             break;
         case SIM900_FAIL:
-            LCDWriteStringXY(0,1,"Fail!");
+            LCDWriteFStringXY(0,1,PSTR("Fail!"));
             break;
         default:
-            LCDWriteStringXY(0,1,"Unknown Error!");
+            LCDWriteFStringXY(0,1,PSTR("Unknown Error!"));
             Halt();
     }
 
-    _delay_ms(3000);
+    _delay_ms(1000);
     LCDClear();
 
+    // Events are batched and sent over GPRS, SMS when the server is out of reach
+    TelemetryInit(TELEMETRY_APN,TELEMETRY_HOST,TELEMETRY_PORT,OPERATOR_NUMBER);
+    TelemetryAdd(TELEMETRY_BOOT,SIM900BootTime());
+    TelemetryAdd(TELEMETRY_RESET,reset_flags);
+
     // Searching Network
-    LCDWriteString("Searching Network");
+    LCDWriteFString(PSTR("Searching Network"));
 
-    uint8_t		NW_found = 0;
 	uint16_t	Num_tries = 0;
 	uint8_t		x = 0;
 
-    while(!NW_found)
+    // The +CREG URC ends the wait as soon as the module registers,
+    // nothing is sent to the module meanwhile
+    while ((response = SIM900WaitRegistered(50)) == SIM900_TIMEOUT)
     {
-        response = SIM900GetNetStat();
-
-        if (response == SIM900_NW_SEARCHING)
-        {
-            LCDWriteStringXY(0,1,"%0%0%0%0%0%0%0%0%0%0%0%0%0%0%0%0");
-			LCDWriteStringXY(x,1,"%1");
+        LCDWriteFStringXY(0,1,PSTR("%0%0%0%0%0%0%0%0%0%0%0%0%0%0%0%0"));
+        LCDWriteFStringXY(x,1,PSTR("%1"));
 
-			x++;
-
-			if (x == 16) x = 0;
-			_delay_ms(50);
-			Num_tries++;
-			if (Num_tries == 600)
-                break;
+        x++;
 
-        }else
+        if (x == 16) x = 0;
+        Num_tries++;
+        if (Num_tries == 600)
             break;
+    }
 
-        if (response == SIM900_NW_REGISTERED_HOME)
-        {
-            LCDWriteString("Network Found.");
-        }else
-        {
-            LCDWriteString("Can not Connect to NW!");
-        }
-        _delay_ms(1000);
-        LCDClear();
+    LCDClear();
+
+    if (response == SIM900_NW_REGISTERED_HOME || response == SIM900_NW_REGISTED_ROAMING)
+    {
+        LCDWriteFString(PSTR("Network Found."));
+    }else
+    {
+        LCDWriteFString(PSTR("Can not Connect to NW!"));
     }
+    _delay_ms(1000);
+    LCDClear();
 
     // Test the module
     uint8_t ref;
 
-    response = SIM900SendMsg("+989126824328","Test",&ref)
+    response = SIM900SendMsg(OPERATOR_NUMBER,"Test",&ref);
 
     switch(response)
     {
         case SIM900_OK:
-            LCDWriteStringXY(0,1,"Success");
-            LCDWriteIntXY(9,1,ref,3);
+            LCDPrintXY(0,1,LCD_FP("Success",9),LCD_I(ref,3));
+            break;
         case SIM900_TIMEOUT:
-            LCDWriteStringXY(0,1,"Time out!");
-        default
-            LCDWriteStringXY(0,1,"Fail!");
-
+            LCDWriteFStringXY(0,1,PSTR("Time out!"));
+            break;
+        default:
+            LCDWriteFStringXY(0,1,PSTR("Fail!"));
     }
 
-    _delay_ms(2000);
+    Pause(2000);
+
+    UARTFlush(&SIM900_UART);
 
-    USART_RxBufferFlush();
+    uint16_t stats_tick = TickNow();    // Start of the current minute
+    uint16_t stats_min = 0;             // Minutes since the last statistics SMS
 
     while (1)
     {
         LCDClear();
-        LCDWriteStringXY(0,0,"Waiting For Message!!!");
+        LCDWriteFStringXY(0,0,PSTR("Waiting For Message!!!"));
 
         x = 0;
         int8_t vx = 1;
 
-        while (SIM900WaitForMsg(&id) != SIM900_OK)
+        // No cursor chasing the animation
+        LCDCursor(LS_NONE);
+
+        while (NextMessage(&id) != SIM900_OK)
         {
-            LCDWriteStringXY(0,1,"%0%0%0%0%0%0%0%0%0%0%0%0%0%0%0%0");
-			LCDWriteStringXY(x,1,"%1");
-			LCDGotoXY(17,1);
+            LCDWriteFStringXY(0,1,PSTR("%0%0%0%0%0%0%0%0%0%0%0%0%0%0%0%0"));
+			LCDWriteFStringXY(x,1,PSTR("%1"));
 
 			x += vx;
 			if (x == 15 || x == 0) vx = vx * (-1);
+
+			// Sample the signal quality now and then, the bars come from the cache
+			if (SIM900SignalTask() == SIM900_OK)
+			{
+                SIM900Signal sig;
+
+                SIM900GetSignal(&sig);
+                TelemetryAdd(TELEMETRY_SIGNAL,sig.rssi);
+			}
+			TelemetryTask();
+			SIM900StorageTask();
+			ConsoleTask();
+
+			// Ping a silent modem, restart it if it does not answer
+			wdt_reset();
+			if (SIM900LivenessTask() == SIM900_BUSY)
+                TelemetryAdd(TELEMETRY_MODEM,SIM900LivenessState());
+			LCDWriteGlyphXY(LCD_COLS-1,0,LCD_GLYPH_SIGNAL_0 + SIM900SignalBars());
+
+			// Periodic statistics report
+			if ((uint16_t)(TickNow() - stats_tick) >= TICKS_MS(60000))
+			{
+                stats_tick += TICKS_MS(60000);
+
+                if (++stats_min >= STATS_REPORT_MIN)
+                {
+                    char report[161];
+
+                    stats_min = 0;
+                    SIM900StatsFormat(report,sizeof(report));
+                    SIM900SendMsg(OPERATOR_NUMBER,report,&ref);
+                }
+			}
         }
 
-        LCDWriteStringXY(0,1,"MSG Received    ");
+        LCDCursor(LS_BLINK|LS_ULINE);
+        LCDPrintXY(0,1,LCD_FP("MSG Received",16));
 		_delay_ms(1000);
 		LCDClear();
 
@@ -150,22 +349,45 @@ int main()
 
 		switch (response)
 		{
+            case SIM900_MSG_DUPLICATE:
+                break;
             case SIM900_OK:
-              LCDWriteStringXY(0,0,msg);
-              _delay_ms(3000);
-            default
-                LCDWriteStringXY(0,0,"Error in Reading Message");
-                _delay_ms(3000);
+                LCDWriteStringXY(0,0,msg);
+                Pause(3000);
+                break;
+            default:
+                LCDWriteFStringXY(0,0,PSTR("Error in Reading Message"));
+                Pause(3000);
+                msg[0] = '\0';     // No command from an unread message
 		}
 
-		if (msg == "OpenValve1"){
+		// A redelivered copy is only deleted, the valve is not switched again
+		if (response == SIM900_MSG_DUPLICATE){
+            LCDWriteFStringXY(0,0,PSTR("Duplicate Message"));
+		} else if (strcmp_P(msg,PSTR("OpenValve1")) == 0){
             PORTB |= 1 << PINB1;
-		} else if (msg == "CloseValve1"){
+            TelemetryAdd(TELEMETRY_VALVE1,1);
+		} else if (strcmp_P(msg,PSTR("CloseValve1")) == 0){
             PORTB &= ~(1 << PINB1);
-		} else if(msg == "OpenValve2"){
+            TelemetryAdd(TELEMETRY_VALVE1,0);
+		} else if(strcmp_P(msg,PSTR("OpenValve2")) == 0){
             PORTB |= 1 << PINB2;
-		} else if(msg == "CloseValve2"){
-            PORTB &= ~(1 << PINB1);
+            TelemetryAdd(TELEMETRY_VALVE2,1);
+		} else if(strcmp_P(msg,PSTR("CloseValve2")) == 0){
+            PORTB &= ~(1 << PINB2);
+            TelemetryAdd(TELEMETRY_VALVE2,0);
+		} else if(strcmp_P(msg,PSTR("Trace")) == 0){
+            // Reply with the last AT exchanges, newest first
+            SIM900TraceFormat(msg,161);
+            SIM900SendMsg(OPERATOR_NUMBER,msg,&ref);
+		} else if(strcmp_P(msg,PSTR("Stats")) == 0){
+            // Reply with the per command counters and latency histograms
+            SIM900StatsFormat(msg,161);
+            SIM900SendMsg(OPERATOR_NUMBER,msg,&ref);
+		} else if(strcmp_P(msg,PSTR("Signal")) == 0){
+            // Reply with the cached signal quality
+            SIM900SignalFormat(msg,161);
+            SIM900SendMsg(OPERATOR_NUMBER,msg,&ref);
 		}
 
 		// delete the received message
@@ -173,8 +395,8 @@ int main()
 
 		if (response != SIM900_OK)
 		{
-            LCDWriteString("Error in Deleting Message!");
-			_delay_ms(3000);
+            LCDWriteFString(PSTR("Error in Deleting Message!"));
+			Pause(3000);
 		}
     }
 }
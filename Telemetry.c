@@ -0,0 +1,291 @@
+/*
+ * Name: Telemetry
+ * Description: Record ring, payload builder and flush policy of the telemetry channel.
+                A payload is a header line "T<seq>,<lost>" followed by one line per record,
+                "<time>,<type>,<value>", oldest first.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "Gen_Def.h"
+#include "Fmt.h"
+#include "Tick.h"
+#include "SIM900.h"
+#include "Telemetry.h"
+
+
+static TelemetryRec Telemetry_ring[TELEMETRY_RING];
+static uint8_t      Telemetry_head;     // Next record to write, not masked
+static uint8_t      Telemetry_tail;     // Oldest record, not masked
+static uint8_t      Telemetry_lost;     // Records dropped because the ring was full, saturates
+static uint16_t     Telemetry_seq;      // Payloads sent
+
+static const char   *Telemetry_apn;
+static const char   *Telemetry_host;
+static uint16_t     Telemetry_port;
+static const char   *Telemetry_sms;
+
+static uint16_t     Telemetry_secs;     // Seconds since TelemetryInit
+static uint16_t     Telemetry_tick;     // Start of the current second
+static uint16_t     Telemetry_retry_at; // No TCP attempt before this second
+static uint16_t     Telemetry_retry = TELEMETRY_RETRY_MIN;
+static uint8_t      Telemetry_fails;    // TCP flushes failed in a row
+static uint16_t     Telemetry_sms_at;   // No SMS attempt before this second
+static uint8_t      Telemetry_sms_off;  // The SMS path failed with an error that will not clear
+
+static char         Telemetry_payload[TELEMETRY_PAYLOAD + 1];
+
+
+/**
+ * Name: TelemetryClock
+ * Description: The function brings the seconds counter up to date.
+ * @Author: Mehdi
+*/
+
+static void TelemetryClock(void)
+{
+    while ((uint16_t)(TickNow() - Telemetry_tick) >= TICK_HZ)
+    {
+        Telemetry_tick += TICK_HZ;
+        Telemetry_secs++;
+    }
+}
+
+
+/**
+ * Name: TelemetryBuild
+ * Description: The function writes the oldest records that fit into the payload.
+ * @Author: Mehdi
+ *
+ * @Params	len (Out): Length of the payload
+ * @Return  Number of records in the payload
+*/
+
+static uint8_t TelemetryBuild(uint8_t *len)
+{
+    uint8_t pos = Telemetry_tail;
+    uint8_t n = 0;
+    char *l, *p, *end = Telemetry_payload + sizeof(Telemetry_payload) - 1;
+
+    p = FmtChar(Telemetry_payload,end,'T');
+    p = FmtU16(p,end,Telemetry_seq);
+    p = FmtChar(p,end,',');
+    p = FmtU8(p,end,Telemetry_lost);
+    l = FmtChar(p,end,'\n');
+
+    while (pos != Telemetry_head)
+    {
+        TelemetryRec *r = &Telemetry_ring[pos & (TELEMETRY_RING - 1)];
+
+        p = FmtU16(l,end,r->time);
+        p = FmtChar(p,end,',');
+        p = FmtU8(p,end,r->type);
+        p = FmtChar(p,end,',');
+        p = FmtI16(p,end,r->value);
+
+        if (p == end)
+            break;      // Does not fit, next payload
+
+        l = FmtChar(p,end,'\n');
+        n++;
+        pos++;
+    }
+
+    *l = '\0';     // Drop a record cut short
+    *len = l - Telemetry_payload;
+
+    return n;
+}
+
+
+/**
+ * Name: TelemetryInit
+ * Description: The function sets the server and the fallback number. The strings are
+ *              kept by reference.
+ * @Author: Mehdi
+ *
+ * @Params	apn: GPRS access point name
+ * @Params	host: Telemetry server name or address
+ * @Params	port: Telemetry server TCP port
+ * @Params	sms_number: Number the payloads go to when the server can not be reached
+*/
+
+void TelemetryInit(const char *apn, const char *host, uint16_t port, const char *sms_number)
+{
+    Telemetry_apn = apn;
+    Telemetry_host = host;
+    Telemetry_port = port;
+    Telemetry_sms = sms_number;
+    Telemetry_sms_off = FALSE;
+
+    Telemetry_tick = TickNow();
+}
+
+
+/**
+ * Name: TelemetryAdd
+ * Description: The function logs an event. When the ring is full the oldest record
+ *              is dropped and counted in the next payload header.
+ * @Author: Mehdi
+ *
+ * @Params	type: TELEMETRY_xxx
+ * @Params	value: Event value
+*/
+
+void TelemetryAdd(uint8_t type, int16_t value)
+{
+    TelemetryRec *r;
+
+    TelemetryClock();
+
+    if ((uint8_t)(Telemetry_head - Telemetry_tail) == TELEMETRY_RING)
+    {
+        Telemetry_tail++;
+
+        if (Telemetry_lost < 255)
+            Telemetry_lost++;
+    }
+
+    r = &Telemetry_ring[Telemetry_head++ & (TELEMETRY_RING - 1)];
+
+    r->time = Telemetry_secs;
+    r->type = type;
+    r->value = value;
+}
+
+
+/**
+ * Name: TelemetryPending
+ * Description: The function returns the number of records not sent yet.
+ * @Author: Mehdi
+*/
+
+uint8_t TelemetryPending(void)
+{
+    return Telemetry_head - Telemetry_tail;
+}
+
+
+/**
+ * Name: TelemetryFlush
+ * Description: The function sends one payload with the oldest records, over TCP (the
+ *              connection is opened if needed and kept) or as an SMS.
+ * @Author: Mehdi
+ *
+ * @Params	via: TELEMETRY_VIA_TCP, TELEMETRY_VIA_SMS
+ * @Return  SIM900_OK: the records were sent and left the ring, or the error of the path
+*/
+
+int8_t TelemetryFlush(uint8_t via)
+{
+    uint8_t len, n, ref;
+    int8_t response;
+
+    if (Telemetry_head == Telemetry_tail)
+        return SIM900_OK;
+
+    n = TelemetryBuild(&len);
+
+    if (via == TELEMETRY_VIA_SMS)
+        response = SIM900SendMsg(Telemetry_sms,Telemetry_payload,&ref);
+    else
+    {
+        response = SIM900TcpOpen(Telemetry_apn,Telemetry_host,Telemetry_port);
+
+        if (response == SIM900_OK)
+            response = SIM900TcpSend(Telemetry_payload,len);
+    }
+
+    if (response != SIM900_OK)
+        return response;
+
+    Telemetry_tail += n;
+    Telemetry_lost = 0;
+    Telemetry_seq++;
+
+    return SIM900_OK;
+}
+
+
+/**
+ * Name: TelemetrySmsFallback
+ * Description: The function sends the due payload as an SMS, led by the class of the
+ *              modem error: a transient one is retried at once, a busy network or SIM
+ *              holds the path for the current TCP retry delay, and an error that can not
+ *              clear (barred or unknown number) closes it until TelemetryInit. The
+ *              records stay in the ring for TCP meanwhile.
+ * @Author: Mehdi
+*/
+
+static void TelemetrySmsFallback(void)
+{
+    int8_t response = TelemetryFlush(TELEMETRY_VIA_SMS);
+
+    if (response == SIM900_FAIL && SIM900LastError(NULL) == SIM900_ERR_RETRY)
+        response = TelemetryFlush(TELEMETRY_VIA_SMS);
+
+    if (response == SIM900_OK)
+        return;
+
+    if (SIM900LastError(NULL) == SIM900_ERR_FATAL)
+        Telemetry_sms_off = TRUE;
+    else
+        Telemetry_sms_at = Telemetry_secs + Telemetry_retry;
+}
+
+
+/**
+ * Name: TelemetryTask
+ * Description: The function sends a payload when a batch is full or the oldest record
+ *              is TELEMETRY_MAX_AGE old. It is meant to be called from the idle loop.
+ *              A failed TCP flush is retried after a delay doubling from
+ *              TELEMETRY_RETRY_MIN to TELEMETRY_RETRY_MAX seconds; after
+ *              TELEMETRY_SMS_AFTER failures in a row the due payloads go out as SMS
+ *              while TCP keeps being retried (TelemetrySmsFallback).
+ * @Author: Mehdi
+*/
+
+void TelemetryTask(void)
+{
+    uint8_t pending;
+
+    TelemetryClock();
+
+    pending = Telemetry_head - Telemetry_tail;
+
+    if (pending == 0)
+        return;
+
+    if (pending < TELEMETRY_BATCH &&
+        (uint16_t)(Telemetry_secs - Telemetry_ring[Telemetry_tail & (TELEMETRY_RING - 1)].time) < TELEMETRY_MAX_AGE)
+        return;
+
+    // Only a link that is backing off waits for Telemetry_retry_at, an idle
+    // stretch of more than 32767 s would otherwise flip the signed compare
+    if (Telemetry_fails == 0 || (int16_t)(Telemetry_secs - Telemetry_retry_at) >= 0)
+    {
+        if (TelemetryFlush(TELEMETRY_VIA_TCP) == SIM900_OK)
+        {
+            Telemetry_fails = 0;
+            Telemetry_retry = TELEMETRY_RETRY_MIN;
+            Telemetry_retry_at = Telemetry_secs;
+            return;
+        }
+
+        if (Telemetry_fails < 255)
+            Telemetry_fails++;
+
+        Telemetry_retry_at = Telemetry_secs + Telemetry_retry;
+
+        if (Telemetry_retry < TELEMETRY_RETRY_MAX)
+            Telemetry_retry <<= 1;
+    }
+
+    if (Telemetry_fails >= TELEMETRY_SMS_AFTER && !Telemetry_sms_off &&
+        (int16_t)(Telemetry_secs - Telemetry_sms_at) >= 0)
+        TelemetrySmsFallback();
+}
@@ -0,0 +1,60 @@
+/*
+ * Name: Telemetry
+ * Description: Batched status reporting. Events are kept in a ring of small binary records and
+                sent together as one text payload over a TCP connection to the telemetry server,
+                instead of one SMS per event. When the server can not be reached for a while the
+                payload goes out as an SMS. A record leaves the ring only once it was sent.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+#ifndef TELEMETRY_RING
+    #define TELEMETRY_RING      32      // Records kept, must be a power of two
+#endif
+#ifndef TELEMETRY_BATCH
+    #define TELEMETRY_BATCH     16      // Records that make a payload worth sending
+#endif
+#ifndef TELEMETRY_MAX_AGE
+    #define TELEMETRY_MAX_AGE   300     // Seconds a record waits for the batch to fill
+#endif
+
+#define TELEMETRY_PAYLOAD       160     // Payload size, fits an SMS
+#define TELEMETRY_RETRY_MIN     10      // Seconds before the first reconnect, doubles on each failure
+#define TELEMETRY_RETRY_MAX     640
+#define TELEMETRY_SMS_AFTER     3       // Failed TCP flushes before the SMS fallback
+
+#if TELEMETRY_RING & (TELEMETRY_RING - 1)
+    #error "TELEMETRY_RING must be a power of two"
+#endif
+
+//Record Types
+#define TELEMETRY_BOOT          1       // value: time to ready (ms)
+#define TELEMETRY_VALVE1        2       // value: 1 open, 0 closed
+#define TELEMETRY_VALVE2        3
+#define TELEMETRY_SIGNAL        4       // value: smoothed <rssi>
+#define TELEMETRY_RESET         5       // value: reset cause flags (MCUCSR/MCUSR) of the AVR
+#define TELEMETRY_MODEM         6       // value: SIM900_LIVE_xxx recovery step taken
+
+//Flush Paths
+#define TELEMETRY_VIA_TCP       0
+#define TELEMETRY_VIA_SMS       1
+
+typedef struct
+{
+    uint16_t    time;       // Seconds since TelemetryInit, wraps after 18 h
+    uint8_t     type;       // TELEMETRY_xxx
+    int16_t     value;
+} TelemetryRec;
+
+void    TelemetryInit(const char *apn, const char *host, uint16_t port, const char *sms_number);
+void    TelemetryAdd(uint8_t type, int16_t value);
+uint8_t TelemetryPending(void);
+int8_t  TelemetryFlush(uint8_t via);
+void    TelemetryTask(void);
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,76 @@
+/*
+ * Name: Tick Lib.
+ * Description: Free running millisecond time base on Timer0.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "Tick.h"
+
+
+static volatile uint16_t Tick_count;   // Ticks since TickInit
+
+
+/**
+ * Name: TickInit
+ * Description: The function starts Timer0 in CTC mode with a TICK_HZ compare interrupt
+ *              and enables global interrupts.
+ * @Author: Mehdi
+*/
+
+void TickInit(void)
+{
+#if defined(OCR0A)      // ATmega644P/1284P
+    OCR0A = TICK_OCR;
+    TCCR0A = (1 << WGM01);                  // CTC
+    TCCR0B = (1 << CS01) | (1 << CS00);     // Pre-scaler 1/64
+    TIMSK0 |= (1 << OCIE0A);
+#else
+    OCR0 = TICK_OCR;
+    TCCR0 = (1 << WGM01) | (1 << CS01) | (1 << CS00);  // CTC, Pre-scaler 1/64
+    TIMSK |= (1 << OCIE0);
+#endif
+    sei();
+}
+
+
+/**
+ * Name: TickNow
+ * Description: The function returns the current tick count.
+ * @Author: Mehdi
+ *
+ * @Return  Ticks since TickInit, modulo 65536
+*/
+
+uint16_t TickNow(void)
+{
+    uint16_t t;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        t = Tick_count;
+    }
+
+    return t;
+}
+
+
+/**
+ * Name: Interrupt Service Routine
+ * Description: It fires on Timer0 compare match and counts the tick
+ * @Author: Mehdi
+*/
+#if defined(OCR0A)
+ISR(TIMER0_COMPA_vect)
+#else
+ISR(TIMER0_COMP_vect)
+#endif
+{
+    Tick_count++;
+}
@@ -0,0 +1,28 @@
+/*
+ * Name: Tick Lib.
+ * Description: Free running millisecond time base on Timer0 (CTC mode), used to time
+                modem exchanges. TickNow() wraps every 65.5 s, so it is meant for
+                measuring intervals shorter than that by subtraction.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef TICK_H_
+#define TICK_H_
+
+#include <stdint.h>
+
+#define TICK_HZ         1000                        // Tick rate (Hz)
+#define TICK_OCR        ((F_CPU / 64 / TICK_HZ) - 1) // Timer0 compare value for prescaler 1/64
+
+#if TICK_OCR > 255
+    #error "TICK_HZ too low for Timer0 with prescaler 1/64"
+#endif
+
+#define TICKS_MS(ms)    ((uint16_t)((uint32_t)(ms) * TICK_HZ / 1000))
+#define MS_TICKS(t)     ((uint16_t)((uint32_t)(t) * 1000 / TICK_HZ))
+
+void     TickInit(void);
+uint16_t TickNow(void);
+
+#endif /* TICK_H_ */
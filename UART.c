@@ -0,0 +1,476 @@
+/*
+ * Name: UART Lib.
+ * Description: Ports, ring buffers and ISRs of the USART driver.
+                Reception is interrupt driven into the receive ring, transmission goes
+                through the transmit ring and the data register empty (UDRE) interrupt,
+                which is only enabled while the ring holds data.
+                Ports with flow control raise RTS from the RX ISR at the high-water mark and
+                lower it from UARTGetc/UARTFlush at the low-water mark. The UDRE ISR stops
+                while CTS is high; there is no CTS interrupt, so the calls that poll the port
+                (UARTAvailable, UARTGetc, a full UARTPutc) restart it once CTS is low again.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include "Gen_Def.h"
+#include "config.h"
+#include "UART.h"
+
+
+#if (UART0_RX_SIZE & (UART0_RX_SIZE - 1)) || (UART0_TX_SIZE & (UART0_TX_SIZE - 1)) || \
+    (UART1_RX_SIZE & (UART1_RX_SIZE - 1)) || (UART1_TX_SIZE & (UART1_TX_SIZE - 1))
+    #error "UART ring sizes must be powers of two"
+#endif
+
+#ifndef UART0_FLOW
+    #define UART0_FLOW  0
+#endif
+#ifndef UART1_FLOW
+    #define UART1_FLOW  0
+#endif
+
+#if (UART0_FLOW && UART0_RX_SIZE < 4 * UART_RTS_SLACK) || (UART1_FLOW && UART1_RX_SIZE < 4 * UART_RTS_SLACK)
+    #error "Flow control needs a receive ring of at least 64 bytes"
+#endif
+
+#define _CONCAT(a,b) a##b
+#define PORT(x) _CONCAT(PORT,x)
+#define DDR(x) _CONCAT(DDR,x)
+#define PIN(x) _CONCAT(PIN,x)
+
+// Control bits, at the same position in every USART of the supported parts
+#define UART_U2X        1
+#define UART_DOR        3
+#define UART_TXEN       3
+#define UART_RXEN       4
+#define UART_UDRIE      5
+#define UART_RXCIE      7
+#define UART_UCSZ0      1
+#define UART_USBS       3
+#define UART_UPM0       4
+
+// Register names of each port
+#if defined(UDR0)       // ATmega644P/1284P
+    #define UART0_UDR       UDR0
+    #define UART0_UCSRA     UCSR0A
+    #define UART0_UCSRB     UCSR0B
+    #define UART0_UCSRC     UCSR0C
+    #define UART0_UBRRH     UBRR0H
+    #define UART0_UBRRL     UBRR0L
+    #define UART0_URSEL     0
+    #define UART0_RX_vect   USART0_RX_vect
+    #define UART0_UDRE_vect USART0_UDRE_vect
+#else                   // ATmega32, UBRRH and UCSRC share an address
+    #define UART0_UDR       UDR
+    #define UART0_UCSRA     UCSRA
+    #define UART0_UCSRB     UCSRB
+    #define UART0_UCSRC     UCSRC
+    #define UART0_UBRRH     UBRRH
+    #define UART0_UBRRL     UBRRL
+    #define UART0_URSEL     (1 << URSEL)
+    #define UART0_RX_vect   USART_RXC_vect
+    #define UART0_UDRE_vect USART_UDRE_vect
+#endif
+
+#if UART_PORTS > 1
+    #define UART1_UDR       UDR1
+    #define UART1_UCSRA     UCSR1A
+    #define UART1_UCSRB     UCSR1B
+    #define UART1_UCSRC     UCSR1C
+    #define UART1_UBRRH     UBRR1H
+    #define UART1_UBRRL     UBRR1L
+    #define UART1_URSEL     0
+    #define UART1_RX_vect   USART1_RX_vect
+    #define UART1_UDRE_vect USART1_UDRE_vect
+#endif
+
+// Flow control lines of each port, a null register without flow control
+#if UART0_FLOW
+    #define UART0_RTS_PORT  (&PORT(UART0_RTS))
+    #define UART0_RTS_BIT   (1 << UART0_RTS_POS)
+    #define UART0_CTS_PIN   (&PIN(UART0_CTS))
+    #define UART0_CTS_BIT   (1 << UART0_CTS_POS)
+#else
+    #define UART0_RTS_PORT  ((volatile uint8_t *)0)
+    #define UART0_RTS_BIT   0
+    #define UART0_CTS_PIN   ((volatile uint8_t *)0)
+    #define UART0_CTS_BIT   0
+#endif
+
+#if UART1_FLOW
+    #define UART1_RTS_PORT  (&PORT(UART1_RTS))
+    #define UART1_RTS_BIT   (1 << UART1_RTS_POS)
+    #define UART1_CTS_PIN   (&PIN(UART1_CTS))
+    #define UART1_CTS_BIT   (1 << UART1_CTS_POS)
+#else
+    #define UART1_RTS_PORT  ((volatile uint8_t *)0)
+    #define UART1_RTS_BIT   0
+    #define UART1_CTS_PIN   ((volatile uint8_t *)0)
+    #define UART1_CTS_BIT   0
+#endif
+
+
+static volatile char UART0_rx[UART0_RX_SIZE];
+static volatile char UART0_tx[UART0_TX_SIZE];
+
+UART UART0 = { &UART0_UCSRA, &UART0_UCSRB, UART0_rx, UART0_tx, UART0_RX_SIZE - 1, UART0_TX_SIZE - 1,
+               UART0_RTS_PORT, UART0_RTS_BIT, UART0_CTS_PIN, UART0_CTS_BIT };
+
+#if UART_PORTS > 1
+static volatile char UART1_rx[UART1_RX_SIZE];
+static volatile char UART1_tx[UART1_TX_SIZE];
+
+UART UART1 = { &UART1_UCSRA, &UART1_UCSRB, UART1_rx, UART1_tx, UART1_RX_SIZE - 1, UART1_TX_SIZE - 1,
+               UART1_RTS_PORT, UART1_RTS_BIT, UART1_CTS_PIN, UART1_CTS_BIT };
+#endif
+
+
+/**
+ * Name: UART_ISRS
+ * Description: Defines the RX and UDRE interrupt service routines of port n. The routines
+ *              use the registers and the instance of the port directly, no pointer is
+ *              followed in interrupt context.
+ *              RX stores the byte, or counts it as lost when the ring is full or the
+ *              hardware reports a data overrun. With flow control it raises RTS once
+ *              the ring holds UART_RX_HIGH bytes.
+ *              UDRE sends the next byte and disables itself when the ring is empty, or
+ *              while CTS is high.
+ * @Author: Mehdi
+*/
+
+#define UART_ISRS(n)                                                            \
+ISR(UART##n##_RX_vect)                                                          \
+{                                                                               \
+    uint8_t status = UART##n##_UCSRA;                                           \
+    char c = UART##n##_UDR;                                                     \
+    uint8_t head = (UART##n.rx_head + 1) & (UART##n##_RX_SIZE - 1);             \
+                                                                                \
+    if ((status & (1 << UART_DOR)) && UART##n.overrun < 255)                    \
+        UART##n.overrun++;                                                      \
+                                                                                \
+    if (head == UART##n.rx_tail)                                                \
+    {                                                                           \
+        if (UART##n.overrun < 255)                                              \
+            UART##n.overrun++;                                                  \
+        return;                                                                 \
+    }                                                                           \
+                                                                                \
+    UART##n##_rx[UART##n.rx_head] = c;                                          \
+    UART##n.rx_head = head;                                                     \
+                                                                                \
+    if (UART##n##_FLOW && !(*UART##n##_RTS_PORT & UART##n##_RTS_BIT) &&         \
+        ((head - UART##n.rx_tail) & (UART##n##_RX_SIZE - 1)) >=                 \
+        UART_RX_HIGH(UART##n##_RX_SIZE))                                        \
+    {                                                                           \
+        *UART##n##_RTS_PORT |= UART##n##_RTS_BIT;                               \
+        if (UART##n.rts_held < 255)                                             \
+            UART##n.rts_held++;                                                 \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+ISR(UART##n##_UDRE_vect)                                                        \
+{                                                                               \
+    uint8_t tail = UART##n.tx_tail;                                             \
+                                                                                \
+    if (tail == UART##n.tx_head ||                                              \
+        (UART##n##_FLOW && (*UART##n##_CTS_PIN & UART##n##_CTS_BIT)))           \
+    {                                                                           \
+        UART##n##_UCSRB &= ~(1 << UART_UDRIE);                                  \
+        return;                                                                 \
+    }                                                                           \
+                                                                                \
+    UART##n##_UDR = UART##n##_tx[tail];                                         \
+    UART##n.tx_tail = (tail + 1) & (UART##n##_TX_SIZE - 1);                     \
+}
+
+UART_ISRS(0)
+
+#if UART_PORTS > 1
+UART_ISRS(1)
+#endif
+
+
+/**
+ * Name: UARTRtsRelease
+ * Description: The function lowers RTS again once the receive ring has drained to the
+ *              low-water mark.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port with flow control
+*/
+
+static void UARTRtsRelease(UART *u)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if ((*u->rts & u->rts_mask) &&
+            ((u->rx_head - u->rx_tail) & u->rx_mask) <= UART_RX_LOW(u->rx_mask + 1))
+            *u->rts &= ~u->rts_mask;
+    }
+}
+
+
+/**
+ * Name: UARTTxResume
+ * Description: The function restarts transmission stopped by a high CTS, when CTS is low
+ *              and bytes are waiting.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port with flow control
+*/
+
+static void UARTTxResume(UART *u)
+{
+    if (u->tx_head != u->tx_tail && !(*u->cts & u->cts_mask))
+    {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            *u->ucsrb |= 1 << UART_UDRIE;
+        }
+    }
+}
+
+
+/**
+ * Name: UARTInit
+ * Description: The function sets up a port and enables its receiver, transmitter and
+ *              receive interrupt, then enables global interrupts.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port, &UART0 or &UART1
+ * @Params	baud: Baud rate
+ * @Params	data_bits: Data size, 5 to 8 bits
+ * @Params	parity: NONE, EVEN or ODD (Gen_Def.h)
+ * @Params	stop_bits: Number of stop bits, 1 or 2
+ * @Params	double_speed: TRUE for double speed asynchronous mode (U2X)
+*/
+
+void UARTInit(UART *u, uint32_t baud, uint8_t data_bits, uint8_t parity, uint8_t stop_bits, uint8_t double_speed)
+{
+    uint8_t div = double_speed ? 8 : 16;
+    uint16_t ubrr = (F_CPU / div + baud / 2) / baud - 1;     // Rounded
+    uint8_t ucsrc = ((data_bits - 5) & 0x03) << UART_UCSZ0;
+
+    if (stop_bits == 2)
+        ucsrc |= 1 << UART_USBS;
+
+    ucsrc |= (parity & 0x03) << UART_UPM0;      // EVEN and ODD are the UPM values
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        u->rx_head = u->rx_tail = 0;
+        u->tx_head = u->tx_tail = 0;
+        u->overrun = 0;
+        u->rts_held = 0;
+    }
+
+    *u->ucsrb = 0;
+    *u->ucsra = double_speed ? (1 << UART_U2X) : 0;
+
+    if (u == &UART0)
+    {
+        UART0_UBRRH = ubrr >> 8;
+        UART0_UBRRL = ubrr;
+        UART0_UCSRC = UART0_URSEL | ucsrc;
+#if UART0_FLOW
+        DDR(UART0_CTS) &= ~(1 << UART0_CTS_POS);
+        PORT(UART0_CTS) |= 1 << UART0_CTS_POS;      // Pulled up, an open CTS holds
+        PORT(UART0_RTS) &= ~(1 << UART0_RTS_POS);   // Ready to receive
+        DDR(UART0_RTS) |= 1 << UART0_RTS_POS;
+#endif
+    }
+#if UART_PORTS > 1
+    else
+    {
+        UART1_UBRRH = ubrr >> 8;
+        UART1_UBRRL = ubrr;
+        UART1_UCSRC = UART1_URSEL | ucsrc;
+#if UART1_FLOW
+        DDR(UART1_CTS) &= ~(1 << UART1_CTS_POS);
+        PORT(UART1_CTS) |= 1 << UART1_CTS_POS;
+        PORT(UART1_RTS) &= ~(1 << UART1_RTS_POS);
+        DDR(UART1_RTS) |= 1 << UART1_RTS_POS;
+#endif
+    }
+#endif
+
+    *u->ucsrb = (1 << UART_RXCIE) | (1 << UART_RXEN) | (1 << UART_TXEN);
+
+    sei();
+}
+
+
+/**
+ * Name: UARTAvailable
+ * Description: The function returns the number of received bytes waiting to be read.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  Bytes in the receive ring
+*/
+
+uint8_t UARTAvailable(UART *u)
+{
+    if (u->cts)
+        UARTTxResume(u);
+
+    return (u->rx_head - u->rx_tail) & u->rx_mask;
+}
+
+
+/**
+ * Name: UARTGetc
+ * Description: The function reads the next received byte.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  The byte, '\0' if nothing was received
+*/
+
+char UARTGetc(UART *u)
+{
+    uint8_t tail = u->rx_tail;
+    char c;
+
+    if (tail == u->rx_head)
+        return '\0';
+
+    c = u->rx[tail];
+    u->rx_tail = (tail + 1) & u->rx_mask;
+
+    if (u->rts)
+    {
+        UARTRtsRelease(u);
+        UARTTxResume(u);
+    }
+
+    return c;
+}
+
+
+/**
+ * Name: UARTPeek
+ * Description: The function returns the next received byte without taking it.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  The byte, '\0' if nothing was received
+*/
+
+char UARTPeek(UART *u)
+{
+    uint8_t tail = u->rx_tail;
+
+    if (tail == u->rx_head)
+        return '\0';
+
+    return u->rx[tail];
+}
+
+
+/**
+ * Name: UARTTxRoom
+ * Description: The function returns the number of bytes UARTPutc takes without waiting.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  Free bytes in the transmit ring
+*/
+
+uint8_t UARTTxRoom(UART *u)
+{
+    if (u->cts)
+        UARTTxResume(u);
+
+    return (u->tx_tail - u->tx_head - 1) & u->tx_mask;
+}
+
+
+/**
+ * Name: UARTPutc
+ * Description: The function queues a byte for transmission. When the ring is full it
+ *              waits for the UDRE interrupt to make room, so it must not be called with
+ *              interrupts disabled. A port held by CTS is polled meanwhile.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	c: Byte to send
+*/
+
+void UARTPutc(UART *u, char c)
+{
+    uint8_t head = u->tx_head;
+    uint8_t next = (head + 1) & u->tx_mask;
+
+    while (next == u->tx_tail)      // Ring full
+    {
+        if (u->cts)
+            UARTTxResume(u);
+    }
+
+    u->tx[head] = c;
+    u->tx_head = next;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        *u->ucsrb |= 1 << UART_UDRIE;
+    }
+}
+
+
+/**
+ * Name: UARTPuts
+ * Description: The function queues a string for transmission.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	s: String to send
+*/
+
+void UARTPuts(UART *u, const char *s)
+{
+    while (*s)
+        UARTPutc(u, *s++);
+}
+
+
+/**
+ * Name: UARTPutsF
+ * Description: The function queues a string kept in flash for transmission.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	s: String to send, in program memory
+*/
+
+void UARTPutsF(UART *u, const char *s)
+{
+    char c;
+
+    while ((c = pgm_read_byte(s++)))
+        UARTPutc(u, c);
+}
+
+
+/**
+ * Name: UARTFlush
+ * Description: The function drops the received bytes not read yet and lowers RTS.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+*/
+
+void UARTFlush(UART *u)
+{
+    u->rx_tail = u->rx_head;
+
+    if (u->rts)
+        UARTRtsRelease(u);
+}
@@ -0,0 +1,81 @@
+/*
+ * Name: UART Lib.
+ * Description: Interrupt driven USART driver with one instance per hardware port. Every port
+                has its own receive and transmit rings and its ISRs are bound to it at compile
+                time, so the modem and a diagnostics console can run side by side.
+                ATmega32 has UART0 only, ATmega644P/1284P also have UART1.
+                A port may use RTS/CTS hardware flow control (UARTn_FLOW in config.h): RTS
+                is raised when the receive ring fills up to UART_RX_HIGH bytes and lowered
+                again once it drains to UART_RX_LOW, transmission pauses while CTS is high.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#if defined(UDR1)
+    #define UART_PORTS  2
+#else
+    #define UART_PORTS  1
+#endif
+
+// Ring sizes, powers of two up to 256. A ring holds size - 1 bytes.
+#ifndef UART0_RX_SIZE
+    #define UART0_RX_SIZE   128
+#endif
+#ifndef UART0_TX_SIZE
+    #define UART0_TX_SIZE   64
+#endif
+#ifndef UART1_RX_SIZE
+    #define UART1_RX_SIZE   16      // Console commands
+#endif
+#ifndef UART1_TX_SIZE
+    #define UART1_TX_SIZE   128     // Trace and statistics output
+#endif
+
+// Flow control watermarks of a receive ring. The room left above the high-water
+// mark takes the bytes the other side still sends after RTS goes high.
+#define UART_RTS_SLACK          16
+#define UART_RX_HIGH(size)      ((size) - UART_RTS_SLACK)
+#define UART_RX_LOW(size)       ((size) / 4)
+
+typedef struct
+{
+    volatile uint8_t    *ucsra;     // Registers of the port
+    volatile uint8_t    *ucsrb;
+    volatile char       *rx;        // Receive ring
+    volatile char       *tx;        // Transmit ring
+    uint8_t             rx_mask;    // Ring size - 1
+    uint8_t             tx_mask;
+    volatile uint8_t    *rts;       // RTS port, NULL without flow control
+    uint8_t             rts_mask;
+    volatile uint8_t    *cts;       // CTS pin register, NULL without flow control
+    uint8_t             cts_mask;
+    volatile uint8_t    rx_head;    // Next byte written by the RX ISR
+    volatile uint8_t    rx_tail;    // Next byte read
+    volatile uint8_t    tx_head;    // Next byte written
+    volatile uint8_t    tx_tail;    // Next byte sent by the UDRE ISR
+    volatile uint8_t    overrun;    // Received bytes lost, saturates at 255
+    volatile uint8_t    rts_held;   // Times RTS was raised, saturates at 255
+} UART;
+
+extern UART UART0;
+#if UART_PORTS > 1
+extern UART UART1;
+#endif
+
+void    UARTInit(UART *u, uint32_t baud, uint8_t data_bits, uint8_t parity, uint8_t stop_bits, uint8_t double_speed);
+uint8_t UARTAvailable(UART *u);
+char    UARTGetc(UART *u);
+char    UARTPeek(UART *u);
+uint8_t UARTTxRoom(UART *u);
+void    UARTPutc(UART *u, char c);
+void    UARTPuts(UART *u, const char *s);
+void    UARTPutsF(UART *u, const char *s);
+void    UARTFlush(UART *u);
+
+#endif /* UART_H_ */
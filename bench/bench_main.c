@@ -0,0 +1,166 @@
+/*
+ * Name: SIM900 Bench Firmware
+ * Description: Firmware image run by sim900_bench under simavr. It drives the SIM900 and LCD
+                APIs through fixed scenarios; the host side plays the modem and times every call.
+                Each scenario starts with a call to BenchScenario(), which the host watches to
+                split the report.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+
+#include "Gen_Def.h"
+#include "config.h"
+#include "UART.h"
+#include "LCD.h"
+#include "Tick.h"
+#include "SIM900.h"
+#include "SIM900Trace.h"
+#include "SIM900Stats.h"
+#include "Telemetry.h"
+
+
+// Scenario numbers, must match the table in sim900_bench.c
+#define BENCH_BOOT          1
+#define BENCH_IDLE          2
+#define BENCH_SMS_BURST     3
+#define BENCH_LONG_SEND     4
+#define BENCH_TELEMETRY_TCP 5
+#define BENCH_TELEMETRY_SMS 6
+#define BENCH_END           0xFF
+
+#define BENCH_BURST_MSGS    8       // Messages the host modem delivers in the burst
+#define BENCH_IDLE_WAITS    20      // SIM900WaitForMsg calls with a silent modem
+#define BENCH_TELEMETRY     64      // Records sent through each telemetry path
+#define BENCH_TCP_PORT      5000    // Host listener of the TCP path
+
+
+/**
+ * Name: BenchScenario
+ * Description: Marks the start of a scenario. The body is empty, the host reads
+ *              the scenario number from the argument register on entry.
+ * @Author: Mehdi
+ *
+ * @Params	id: Scenario number
+*/
+
+void __attribute__((noinline)) BenchScenario(uint8_t id)
+{
+    asm volatile ("" : : "r" (id));
+}
+
+
+#if UART_PORTS > 1
+static void BenchConsolePut(char c)
+{
+    UARTPutc(&CONSOLE_UART,c);
+}
+#endif
+
+
+int main()
+{
+    uint8_t id, ref, i;
+    char msg[128];
+
+    // 160 char SMS body, the longest single-part text message
+    const char *long_msg =
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "0123456789ABCDEF";
+
+    BenchScenario(BENCH_BOOT);
+
+    TickInit();
+
+    UARTInit(&SIM900_UART,9600,8,NONE,1,0);
+#if UART_PORTS > 1
+    UARTInit(&CONSOLE_UART,38400,8,NONE,1,0);
+#endif
+
+    // The host modem starts switched off, it boots while the LCD is set up
+    SIM900BootStart();
+
+    LCDInit(LS_NONE);
+    LCDWriteFString(PSTR("Initializing SIM900"));
+
+    while (SIM900BootTask() == SIM900_BUSY);
+
+    SIM900Init();
+    SIM900GetNetStat();
+
+    BenchScenario(BENCH_IDLE);
+
+    for (i = 0; i < BENCH_IDLE_WAITS; i++)
+        SIM900WaitForMsg(&id);
+
+    BenchScenario(BENCH_SMS_BURST);
+
+    for (i = 0; i < BENCH_BURST_MSGS; i++)
+    {
+        while (SIM900WaitForMsg(&id) != SIM900_OK);
+
+        if (SIM900ReadMsg(id,msg) == SIM900_OK)
+            LCDWriteStringXY(0,0,msg);
+
+        SIM900DeleteMsg(id);
+    }
+
+    BenchScenario(BENCH_LONG_SEND);
+
+    SIM900SendMsg("+989120000000",long_msg,&ref);
+
+    // Same records through both paths, TELEMETRY_BATCH at a time as TelemetryTask would
+    TelemetryInit("internet","127.0.0.1",BENCH_TCP_PORT,"+989120000000");
+
+    BenchScenario(BENCH_TELEMETRY_TCP);
+
+    for (i = 0; i < BENCH_TELEMETRY; i++)
+    {
+        TelemetryAdd(TELEMETRY_VALVE1,i & 1);
+
+        if (TelemetryPending() >= TELEMETRY_BATCH)
+            while (TelemetryPending() && TelemetryFlush(TELEMETRY_VIA_TCP) == SIM900_OK);
+    }
+
+    SIM900TcpClose();
+
+    BenchScenario(BENCH_TELEMETRY_SMS);
+
+    for (i = 0; i < BENCH_TELEMETRY; i++)
+    {
+        TelemetryAdd(TELEMETRY_VALVE1,i & 1);
+
+        if (TelemetryPending() >= TELEMETRY_BATCH)
+            while (TelemetryPending() && TelemetryFlush(TELEMETRY_VIA_SMS) == SIM900_OK);
+    }
+
+#if UART_PORTS > 1
+    // The host prints the console, the modem port stays quiet meanwhile
+    SIM900StatsFormat(msg,sizeof(msg));
+    UARTPuts(&CONSOLE_UART,msg);
+    UARTPutsF(&CONSOLE_UART,PSTR("\r\n"));
+    SIM900DeliveryFormat(msg,sizeof(msg));
+    UARTPuts(&CONSOLE_UART,msg);
+    UARTPutsF(&CONSOLE_UART,PSTR("\r\n"));
+    SIM900TraceStream(0,BenchConsolePut);
+
+    while (CONSOLE_UART.tx_head != CONSOLE_UART.tx_tail);   // Let the ring drain
+#endif
+
+    BenchScenario(BENCH_END);
+
+    // Sleeping with interrupts off ends the simulation
+    cli();
+    sleep_enable();
+    sleep_cpu();
+
+    return 0;
+}
@@ -0,0 +1,796 @@
+/*
+ * Name: SIM900 Bench
+ * Description: Host side of the benchmark. It runs the bench firmware on simavr's ATmega32 at
+                7.3728 MHz, plays a scripted SIM900 on USART0 and reports, per scenario, the cycle
+                count of every SIM900/LCD API call, the worst-case duration of each ISR, the
+                peak stack depth, the size of the flash image and whether vfprintf is in it.
+                The modem starts switched off and powers up when PWRKEY (PD4, through the
+                inverting driver of config.h) is held for a second, as a cold board does.
+                It stops sending while the firmware raises RTS (PC0, UART0_FLOW builds).
+                Calls are found from the symbol table (make's .sym file): a call starts when the
+                PC reaches the symbol and ends when SP rises above its value at entry. Durations
+                are inclusive, i.e. they contain callees and interrupts.
+ * Usage: sim900_bench <firmware.elf> <firmware.sym> [mcu]
+                The modem's TCP connections (AT+CIPSTART) are real connections from this
+                process, so the telemetry payloads reach whatever listens on the port the
+                firmware uses, ex "nc -lk 5000". Without a listener they fail with CONNECT
+                FAIL and the firmware falls back to SMS. Delivered telemetry records are
+                counted per scenario.
+                mcu is atmega32 (default), atmega644p or atmega1284p. On the dual USART parts
+                the second port is the diagnostics console, its output is printed as it comes.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_irq.h>
+#include <sim_io.h>
+#include <avr_uart.h>
+#include <avr_ioport.h>
+
+
+#define BENCH_MCU           "atmega32"                 // Default core, see usage
+#define BENCH_F_CPU         7372800UL
+#define BENCH_FLASH_SIZE    0x20000                    // Largest supported part, ATmega1284P
+
+#define BENCH_MAX_CYCLES    (120ULL * BENCH_F_CPU)     // Give up after 120 s of simulated time
+
+#define MS(ms)              ((uint64_t)(ms) * (BENCH_F_CPU / 1000))
+
+
+/****************************************************************************
+                                SCENARIOS
+*****************************************************************************/
+
+// Must match the numbers in bench_main.c
+#define BENCH_BOOT          1
+#define BENCH_IDLE          2
+#define BENCH_SMS_BURST     3
+#define BENCH_LONG_SEND     4
+#define BENCH_TELEMETRY_TCP 5
+#define BENCH_TELEMETRY_SMS 6
+#define BENCH_END           0xFF
+
+#define MAX_SCENARIOS       7
+
+static const char *scenario_names[MAX_SCENARIOS] =
+{
+    "startup", "boot", "idle wait", "SMS burst", "long send", "telemetry TCP", "telemetry SMS"
+};
+
+#define BURST_MSGS          8       // Must match BENCH_BURST_MSGS
+
+
+/****************************************************************************
+                                VIRTUAL MODEM
+*****************************************************************************/
+
+// Modem latencies, roughly what a SIM900 on a live network shows
+#define LAT_AT              MS(10)
+#define LAT_CREG            MS(20)
+#define LAT_CMGR            MS(40)
+#define LAT_CMGD            MS(40)
+#define LAT_PROMPT          MS(50)
+#define LAT_CMGS            MS(1500)
+#define LAT_URC             MS(100)
+#define LAT_CDS             LAT_CMGS    // Status report right after the result, delivery time not modelled
+#define LAT_CIICR           MS(2000)    // GPRS bearer activation
+#define LAT_CONNECT         MS(800)     // TCP handshake over GPRS
+#define LAT_TCP_SEND        MS(300)     // Data acknowledged by the server
+
+// Power on: PWRKEY low time, then readiness URCs timed from PWRKEY release
+#define PWRKEY_MIN          MS(1000)
+#define BOOT_RDY            MS(1500)
+#define BOOT_CFUN           MS(1600)
+#define BOOT_CPIN           MS(1700)
+#define BOOT_CALL           MS(4200)
+
+#define MAX_SEGMENTS        16
+
+typedef struct
+{
+    char        text[256];
+    uint16_t    pos;
+    uint64_t    due;        // Cycle from which the text may be sent
+} segment_t;
+
+static segment_t segments[MAX_SEGMENTS];
+static uint8_t   seg_head, seg_count;
+
+static char      line[512];
+static uint16_t  line_len;
+static uint8_t   in_body;           // Receiving an SMS body after the '>' prompt
+static uint8_t   msg_ref;           // <mr> of the last message sent
+static uint16_t  in_data;           // Bytes of TCP data still expected after the '>' prompt
+static char      payload[2048];     // SMS body or TCP data being received
+static uint16_t  payload_len;
+static int       tcp_fd = -1;       // Connection opened by AT+CIPSTART
+static uint32_t  records[MAX_SCENARIOS];
+static int       scenario;
+static uint8_t   burst_left;
+static uint8_t   uart_xon = 1;
+static uint8_t   uart_rts;          // RTS (PC0) high, the firmware asks the modem to stop
+static uint32_t  rts_holds;
+static uint8_t   powered;
+static uint8_t   echo = 1;          // ATE1, the factory setting
+static uint8_t   profile;           // Library profile applied
+static uint64_t  pwrkey_down;       // Cycle PWRKEY went low, 0 if released
+
+static avr_t     *avr;
+static avr_irq_t *uart_in;
+static avr_irq_t *console_out;
+
+static void modem_send(const char *text, uint64_t delay)
+{
+    if (seg_count == MAX_SEGMENTS)
+    {
+        fprintf(stderr, "modem: reply queue full\n");
+        exit(1);
+    }
+
+    segment_t *s = &segments[(seg_head + seg_count++) % MAX_SEGMENTS];
+
+    snprintf(s->text, sizeof(s->text), "%s", text);
+    s->pos = 0;
+    s->due = avr->cycle + delay;
+}
+
+static void modem_urc(void)
+{
+    char urc[32];
+
+    snprintf(urc, sizeof(urc), "\r\n+CMTI: \"ME\",%d\r\n", BURST_MSGS - burst_left + 1);
+    burst_left--;
+    modem_send(urc, LAT_URC);
+}
+
+static void tcp_close(void)
+{
+    if (tcp_fd >= 0)
+        close(tcp_fd);
+    tcp_fd = -1;
+}
+
+// Opens the connection of AT+CIPSTART="TCP","host","port"
+static int tcp_open(const char *args)
+{
+    char host[64], port[8];
+    struct addrinfo hints, *ai;
+
+    tcp_close();
+
+    if (sscanf(args, "\"TCP\",\"%63[^\"]\",\"%7[^\"]\"", host, port) != 2)
+        return 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(host, port, &hints, &ai) != 0)
+        return 0;
+
+    tcp_fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (tcp_fd >= 0 && connect(tcp_fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        tcp_close();
+
+    freeaddrinfo(ai);
+
+    return tcp_fd >= 0;
+}
+
+// Counts the records of a telemetry payload, one line each after the "T<seq>" header
+static void count_records(void)
+{
+    if (payload_len == 0 || payload[0] != 'T')
+        return;
+
+    for (uint16_t i = 0; i < payload_len; i++)
+        if (payload[i] == '\n')
+            records[scenario]++;
+
+    records[scenario]--;    // Header line
+}
+
+static void modem_line(const char *cmd)
+{
+    char text[sizeof(line) + 2];
+
+    if (echo)
+    {
+        snprintf(text, sizeof(text), "%s\r", cmd);
+        modem_send(text, 0);
+    }
+
+    if (strcasecmp(cmd, "AT+CPIN?;+CFUN?;+CCALR?") == 0)
+        modem_send("\r\n+CPIN: READY\r\n\r\n+CFUN: 1\r\n\r\n+CCALR: 1\r\n\r\nOK\r\n", LAT_AT);
+    else if (strncasecmp(cmd, "AT+CMGF?;+CNMI?;+CMEE?;+CSCS?;+CSMP?", 36) == 0)
+    {
+        // Flow control builds append ;+IFC?
+        if (profile)
+            modem_send("\r\n+CMGF: 1\r\n\r\n+CNMI: 2,1,0,1,0\r\n\r\n+CMEE: 1\r\n"
+                       "\r\n+CSCS: \"GSM\"\r\n\r\n+CSMP: 49,167,0,0\r\n", LAT_AT);
+        else
+            modem_send("\r\n+CMGF: 0\r\n\r\n+CNMI: 0,0,0,0,0\r\n\r\n+CMEE: 0\r\n"
+                       "\r\n+CSCS: \"IRA\"\r\n\r\n+CSMP: 17,167,0,0\r\n", LAT_AT);
+
+        if (cmd[36])
+            modem_send(profile ? "\r\n+IFC: 2,2\r\n" : "\r\n+IFC: 0,0\r\n", 0);
+
+        modem_send("\r\nOK\r\n", 0);
+    }
+    else if (strncasecmp(cmd, "ATE0+CMGF=1;", 12) == 0)
+    {
+        echo = 0;
+        profile = 1;
+        modem_send("\r\nOK\r\n", LAT_AT);
+    }
+    else if (strcasecmp(cmd, "AT") == 0 || strcasecmp(cmd, "AT&W") == 0)
+        modem_send("\r\nOK\r\n", LAT_AT);
+    else if (strcasecmp(cmd, "AT+CREG?") == 0)
+        modem_send("\r\n+CREG: 1,1\r\n\r\nOK\r\n", LAT_CREG);
+    else if (strcasecmp(cmd, "AT+CREG=1") == 0)
+        modem_send("\r\nOK\r\n", LAT_AT);
+    else if (strcasecmp(cmd, "AT+CSQ") == 0)
+        modem_send("\r\n+CSQ: 18,0\r\n\r\nOK\r\n", LAT_AT);
+    else if (strcasecmp(cmd, "AT+CPMS=\"SM\",\"SM\",\"SM\"") == 0)
+        modem_send("\r\n+CPMS: 0,30,0,30,0,30\r\n\r\nOK\r\n", LAT_AT);
+    else if (strcasecmp(cmd, "AT+CPMS=\"ME\",\"ME\",\"ME\"") == 0)
+        modem_send("\r\n+CPMS: 0,50,0,50,0,50\r\n\r\nOK\r\n", LAT_AT);
+    else if (strncasecmp(cmd, "AT+CMGL=", 8) == 0 || strncasecmp(cmd, "AT+CMGDA=", 9) == 0)
+        modem_send("\r\nOK\r\n", LAT_CMGD);     // Storage starts empty
+    else if (strncasecmp(cmd, "AT+CMGR=", 8) == 0)
+    {
+        // One time stamp per slot, the last message of the burst is a redelivered
+        // copy of the one before it
+        int slot = atoi(cmd + 8);
+
+        snprintf(text, sizeof(text), "\r\n+CMGR: \"REC UNREAD\",\"+989120000000\",,"
+                 "\"16/12/22,10:00:%02d+14\"\r\nOpenValve1\r\n\r\nOK\r\n",
+                 slot == BURST_MSGS ? slot - 1 : slot);
+        modem_send(text, LAT_CMGR);
+    }
+    else if (strncasecmp(cmd, "AT+CMGD=", 8) == 0)
+    {
+        modem_send("\r\nOK\r\n", LAT_CMGD);
+        if (burst_left)
+            modem_urc();
+    }
+    else if (strncasecmp(cmd, "AT+CMGS=", 8) == 0)
+    {
+        modem_send("\r\n> ", LAT_PROMPT);
+        in_body = 1;
+        payload_len = 0;
+    }
+    else if (strcasecmp(cmd, "AT+CIPSHUT") == 0)
+    {
+        tcp_close();
+        modem_send("\r\nSHUT OK\r\n", LAT_AT);
+    }
+    else if (strncasecmp(cmd, "AT+CSTT=", 8) == 0)
+        modem_send("\r\nOK\r\n", LAT_AT);
+    else if (strcasecmp(cmd, "AT+CIICR") == 0)
+        modem_send("\r\nOK\r\n", LAT_CIICR);
+    else if (strcasecmp(cmd, "AT+CIFSR") == 0)
+        modem_send("\r\n10.64.0.2\r\n", LAT_AT);
+    else if (strncasecmp(cmd, "AT+CIPSTART=", 12) == 0)
+    {
+        modem_send("\r\nOK\r\n", LAT_AT);
+        modem_send(tcp_open(cmd + 12) ? "\r\nCONNECT OK\r\n" : "\r\nCONNECT FAIL\r\n", LAT_CONNECT);
+    }
+    else if (strncasecmp(cmd, "AT+CIPSEND=", 11) == 0)
+    {
+        if (tcp_fd < 0)
+            modem_send("\r\nERROR\r\n", LAT_AT);
+        else
+        {
+            modem_send("\r\n> ", LAT_PROMPT);
+            in_data = atoi(cmd + 11);
+            payload_len = 0;
+        }
+    }
+    else if (strcasecmp(cmd, "AT+CIPCLOSE") == 0)
+    {
+        tcp_close();
+        modem_send("\r\nCLOSE OK\r\n", LAT_AT);
+    }
+    else
+        modem_send("\r\nERROR\r\n", LAT_AT);
+}
+
+// Byte transmitted by the firmware
+static void uart_out_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    char text[128];
+    uint8_t c = value;
+
+    if (!powered)
+        return;
+
+    if (in_body)
+    {
+        if (c == 0x1A)
+        {
+            in_body = 0;
+            count_records();
+            msg_ref++;
+            snprintf(text, sizeof(text), "\r\n+CMGS: %u\r\n\r\nOK\r\n", msg_ref);
+            modem_send(text, LAT_CMGS);
+
+            // Status report, +CSMP SRR is part of the library profile
+            snprintf(text, sizeof(text), "\r\n+CDS: 6,%u,\"+989120000000\",145,"
+                     "\"26/10/19,12:00:00+14\",\"26/10/19,12:00:02+14\",0\r\n", msg_ref);
+            modem_send(text, LAT_CDS);
+        } else if (payload_len < sizeof(payload))
+            payload[payload_len++] = c;
+        return;
+    }
+
+    if (in_data)
+    {
+        if (payload_len < sizeof(payload))
+            payload[payload_len++] = c;
+
+        if (--in_data == 0)
+        {
+            if (send(tcp_fd, payload, payload_len, MSG_NOSIGNAL) == payload_len)
+            {
+                count_records();
+                modem_send("\r\nSEND OK\r\n", LAT_TCP_SEND);
+            }
+            else
+            {
+                tcp_close();
+                modem_send("\r\nSEND FAIL\r\n\r\nCLOSED\r\n", LAT_TCP_SEND);
+            }
+        }
+        return;
+    }
+
+    if (c == '\r')
+    {
+        line[line_len] = '\0';
+        if (line_len)
+            modem_line(line);
+        line_len = 0;
+    } else if (c != '\n' && line_len < sizeof(line) - 1)
+        line[line_len++] = c;
+}
+
+// PWRKEY driver pin, high pulls PWRKEY low
+static void pwrkey_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    if (value)
+    {
+        if (!pwrkey_down)
+            pwrkey_down = avr->cycle ? avr->cycle : 1;
+        return;
+    }
+
+    if (pwrkey_down && !powered && avr->cycle - pwrkey_down >= PWRKEY_MIN)
+    {
+        powered = 1;
+        modem_send("\r\nRDY\r\n", BOOT_RDY);
+        modem_send("\r\n+CFUN: 1\r\n", BOOT_CFUN);
+        modem_send("\r\n+CPIN: READY\r\n", BOOT_CPIN);
+        modem_send("\r\nCall Ready\r\n", BOOT_CALL);
+    }
+
+    pwrkey_down = 0;
+}
+
+// Byte sent on the console USART, printed line by line
+static void console_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    static char text[128];
+    static int len;
+    char c = value;
+
+    if (c == '\n' || len == sizeof(text) - 1)
+    {
+        text[len] = '\0';
+        printf("console: %s\n", text);
+        len = 0;
+    } else if (c != '\r')
+        text[len++] = c;
+}
+
+static void uart_xon_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    uart_xon = 1;
+}
+
+static void uart_xoff_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    uart_xon = 0;
+}
+
+// RTS output of the firmware, only driven when it is built with UART0_FLOW
+static void rts_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    if (value && !uart_rts)
+        rts_holds++;
+    uart_rts = value;
+}
+
+// Feeds the next due reply byte into the simulated USART
+static void modem_poll(void)
+{
+    while (seg_count && uart_xon && !uart_rts)
+    {
+        segment_t *s = &segments[seg_head];
+
+        if (avr->cycle < s->due)
+            return;
+
+        avr_raise_irq(uart_in, (uint8_t)s->text[s->pos++]);
+
+        if (s->text[s->pos] == '\0')
+        {
+            seg_head = (seg_head + 1) % MAX_SEGMENTS;
+            seg_count--;
+        }
+    }
+}
+
+
+/****************************************************************************
+                                PROBES
+*****************************************************************************/
+
+#define MAX_PROBES          128
+#define MAX_FRAMES          64
+
+typedef struct
+{
+    uint32_t    calls;
+    uint64_t    total;
+    uint64_t    min;
+    uint64_t    max;
+} stat_t;
+
+typedef struct
+{
+    char        name[64];
+    uint32_t    addr;
+    stat_t      stat[MAX_SCENARIOS];
+} probe_t;
+
+typedef struct
+{
+    int16_t     probe;
+    uint16_t    sp;
+    uint64_t    start;
+} frame_t;
+
+static probe_t  probes[MAX_PROBES];
+static int      probe_count;
+static int16_t  probe_at[BENCH_FLASH_SIZE / 2];    // Probe index for each flash word, -1 if none
+static int      scenario_probe = -1;
+
+static frame_t  frames[MAX_FRAMES];
+static int      depth;
+
+static uint16_t min_sp[MAX_SCENARIOS];
+static uint64_t scenario_start[MAX_SCENARIOS];
+static uint64_t scenario_cycles[MAX_SCENARIOS];
+
+static const char *mcu = BENCH_MCU;
+static uint16_t ramend;
+static uint32_t flash_used;     // Bytes of the firmware image
+static int      has_printf;     // vfprintf is linked in, the modem layer should not need it
+
+static const char *display_name(const char *sym)
+{
+    static const struct { const char *mcu, *sym, *name; } vectors[] =
+    {
+        { "atmega32",    "__vector_10", "ISR(TIMER0_COMP_vect)"   },
+        { "atmega32",    "__vector_13", "ISR(USART_RXC_vect)"     },
+        { "atmega32",    "__vector_14", "ISR(USART_UDRE_vect)"    },
+        { "atmega644p",  "__vector_16", "ISR(TIMER0_COMPA_vect)"  },
+        { "atmega644p",  "__vector_20", "ISR(USART0_RX_vect)"     },
+        { "atmega644p",  "__vector_21", "ISR(USART0_UDRE_vect)"   },
+        { "atmega644p",  "__vector_28", "ISR(USART1_RX_vect)"     },
+        { "atmega644p",  "__vector_29", "ISR(USART1_UDRE_vect)"   },
+    };
+    // The 1284P has the vector table of the 644P
+    const char *table = strcmp(mcu, "atmega1284p") == 0 ? "atmega644p" : mcu;
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+        if (strcmp(vectors[i].mcu, table) == 0 && strcmp(vectors[i].sym, sym) == 0)
+            return vectors[i].name;
+    return sym;
+}
+
+// Every SIM900*, LCD*, USART* function and every ISR is probed
+static void load_symbols(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char buf[256], type, name[200];
+    unsigned int addr;
+
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    memset(probe_at, 0xFF, sizeof(probe_at));
+
+    while (fgets(buf, sizeof(buf), f))
+    {
+        if (sscanf(buf, "%x %c %199s", &addr, &type, name) != 3)
+            continue;
+        if (type != 'T' && type != 't')
+            continue;
+        if (strcmp(name, "vfprintf") == 0)
+            has_printf = 1;
+        if (addr >= BENCH_FLASH_SIZE || probe_count == MAX_PROBES)
+            continue;
+        if (strncmp(name, "SIM900", 6) && strncmp(name, "LCD", 3) && strncmp(name, "USART", 5)
+            && strncmp(name, "__vector_", 9) && strcmp(name, "BenchScenario"))
+            continue;
+        if (strcmp(name, "__vector_default") == 0)
+            continue;
+
+        probe_t *p = &probes[probe_count];
+
+        snprintf(p->name, sizeof(p->name), "%s", display_name(name));
+        p->addr = addr;
+        probe_at[addr / 2] = probe_count;
+
+        if (strcmp(name, "BenchScenario") == 0)
+            scenario_probe = probe_count;
+
+        probe_count++;
+    }
+
+    fclose(f);
+
+    if (scenario_probe < 0)
+    {
+        fprintf(stderr, "%s: BenchScenario not found\n", path);
+        exit(1);
+    }
+}
+
+static uint16_t read_sp(void)
+{
+    return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+static void frame_end(frame_t *fr)
+{
+    stat_t *st = &probes[fr->probe].stat[scenario];
+    uint64_t cycles = avr->cycle - fr->start;
+
+    if (st->calls == 0 || cycles < st->min)
+        st->min = cycles;
+    if (cycles > st->max)
+        st->max = cycles;
+    st->total += cycles;
+    st->calls++;
+}
+
+static void set_scenario(int id)
+{
+    scenario_cycles[scenario] += avr->cycle - scenario_start[scenario];
+
+    if (id == BENCH_END)
+        return;
+
+    scenario = (id < MAX_SCENARIOS) ? id : 0;
+    scenario_start[scenario] = avr->cycle;
+
+    if (scenario == BENCH_SMS_BURST)
+    {
+        burst_left = BURST_MSGS;
+        modem_urc();
+    }
+}
+
+static void probe_step(void)
+{
+    uint16_t sp = read_sp();
+    int16_t p;
+
+    if (sp < min_sp[scenario])
+        min_sp[scenario] = sp;
+
+    // Calls whose return address has been popped are done
+    while (depth && sp > frames[depth - 1].sp)
+        frame_end(&frames[--depth]);
+
+    p = probe_at[(avr->pc / 2) % (BENCH_FLASH_SIZE / 2)];
+    if (p < 0)
+        return;
+
+    // A jump back to the entry of the function being timed is not a new call
+    if (depth && frames[depth - 1].probe == p && frames[depth - 1].sp == sp)
+        return;
+
+    if (p == scenario_probe)
+    {
+        set_scenario(avr->data[24]);   // First argument is passed in r24
+        return;
+    }
+
+    if (depth == MAX_FRAMES)
+    {
+        fprintf(stderr, "probe: call depth overflow at %s\n", probes[p].name);
+        exit(1);
+    }
+
+    frames[depth].probe = p;
+    frames[depth].sp = sp;
+    frames[depth].start = avr->cycle;
+    depth++;
+}
+
+
+/****************************************************************************
+                                REPORT
+*****************************************************************************/
+
+static double cycles_to_us(uint64_t cycles)
+{
+    return cycles * 1e6 / BENCH_F_CPU;
+}
+
+static void report(void)
+{
+    uint16_t peak = ramend;
+
+    for (int s = 0; s < MAX_SCENARIOS; s++)
+    {
+        if (scenario_cycles[s] == 0)
+            continue;
+
+        printf("\n== %s: %llu cycles (%.1f ms), stack %u bytes\n", scenario_names[s],
+               (unsigned long long)scenario_cycles[s], cycles_to_us(scenario_cycles[s]) / 1000,
+               ramend - min_sp[s]);
+        if (records[s])
+            printf("telemetry: %u records delivered, %.2f records/s\n", records[s],
+                   records[s] / (cycles_to_us(scenario_cycles[s]) / 1e6));
+        printf("%-24s %7s %12s %12s %12s %12s\n", "function", "calls", "min", "avg", "max", "max us");
+
+        for (int i = 0; i < probe_count; i++)
+        {
+            stat_t *st = &probes[i].stat[s];
+
+            if (st->calls == 0)
+                continue;
+
+            printf("%-24s %7u %12llu %12llu %12llu %12.1f\n", probes[i].name, st->calls,
+                   (unsigned long long)st->min, (unsigned long long)(st->total / st->calls),
+                   (unsigned long long)st->max, cycles_to_us(st->max));
+        }
+
+        if (min_sp[s] < peak)
+            peak = min_sp[s];
+    }
+
+    printf("\nPeak stack depth: %u bytes (SP low water 0x%04X)\n", ramend - peak, peak);
+    printf("Flash image: %u bytes, vfprintf %s\n", flash_used, has_printf ? "linked" : "not linked");
+
+    if (rts_holds)
+        printf("RTS held the modem %u times\n", rts_holds);
+
+    for (int i = 0; i < probe_count; i++)
+    {
+        uint64_t worst = 0;
+
+        if (strncmp(probes[i].name, "ISR(", 4))
+            continue;
+
+        for (int s = 0; s < MAX_SCENARIOS; s++)
+            if (probes[i].stat[s].max > worst)
+                worst = probes[i].stat[s].max;
+
+        if (worst)
+            printf("Worst-case %s: %llu cycles (%.1f us)\n", probes[i].name,
+                   (unsigned long long)worst, cycles_to_us(worst));
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    elf_firmware_t fw;
+    uint32_t flags = 0;
+    int state;
+
+    if (argc != 3 && argc != 4)
+    {
+        fprintf(stderr, "usage: %s <firmware.elf> <firmware.sym> [mcu]\n", argv[0]);
+        return 1;
+    }
+
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(argv[1], &fw) != 0)
+    {
+        fprintf(stderr, "%s: cannot load firmware\n", argv[1]);
+        return 1;
+    }
+
+    if (argc == 4)
+        mcu = argv[3];
+
+    load_symbols(argv[2]);
+
+    avr = avr_make_mcu_by_name(mcu);
+    if (!avr)
+    {
+        fprintf(stderr, "simavr has no %s core\n", mcu);
+        return 1;
+    }
+
+    avr_init(avr);
+    avr_load_firmware(avr, &fw);
+    avr->frequency = BENCH_F_CPU;
+    flash_used = fw.flashsize;
+
+    // Keep simavr from echoing the UART on stdout, the modem owns it
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+                            uart_out_hook, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUT_XON),
+                            uart_xon_hook, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUT_XOFF),
+                            uart_xoff_hook, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 4),
+                            pwrkey_hook, NULL);
+    uart_in = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+
+    // RTS/CTS on PC0/PC1, the modem always takes data so CTS stays low
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), 0),
+                            rts_hook, NULL);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), 1), 0);
+
+    // Second USART, only on the dual port parts
+    console_out = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('1'), UART_IRQ_OUTPUT);
+    if (console_out)
+    {
+        flags = 0;
+        avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('1'), &flags);
+        flags &= ~AVR_UART_FLAG_STDIO;
+        avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('1'), &flags);
+        avr_irq_register_notify(console_out, console_hook, NULL);
+    }
+
+    ramend = avr->ramend;
+    for (int s = 0; s < MAX_SCENARIOS; s++)
+        min_sp[s] = ramend;
+
+    do
+    {
+        probe_step();
+        modem_poll();
+        state = avr_run(avr);
+
+        if (avr->cycle > BENCH_MAX_CYCLES)
+        {
+            fprintf(stderr, "bench: no end after %llu cycles, scenario '%s'\n",
+                    (unsigned long long)avr->cycle, scenario_names[scenario]);
+            report();
+            return 1;
+        }
+    } while (state != cpu_Done && state != cpu_Crashed);
+
+    report();
+
+    return state == cpu_Crashed;
+}
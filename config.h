@@ -20,8 +20,13 @@
 #define LCD_E B			//Enable/strobe signal (E)-> PB4
 #define LCD_E_POS	PB4	//Position of enable in above port
 
+#if defined(UDR1)		//PD2/PD3 carry the console USART on ATmega644P/1284P
+#define LCD_RS D		//Register Select signal (RS)-> PD5
+#define LCD_RS_POS	PD5
+#else
 #define LCD_RS D		//Register Select signal (RS)-> PD3
 #define LCD_RS_POS	PD3
+#endif
 
 #define LCD_RW D		//Read/Write signal (R/W) ->PD6
 #define LCD_RW_POS	PD6
@@ -43,6 +48,39 @@ Uncomment Just one of them
 //#define LCD_TYPE_164	//For 16 Chars by 4 lines
 
 
+//************************************************
+
+
+/************************************************
+	SIM900 CONNECTIONS
+*************************************************/
+
+#define SIM900_UART UART0		//USART the module is wired to
+
+#define CONSOLE_UART UART1		//Diagnostics console, ATmega644P/1284P only
+
+#define SIM900_PWRKEY D		//PWRKEY driver -> PD4
+#define SIM900_PWRKEY_POS PD4
+
+#define SIM900_PWRKEY_INVERT 1	//1: the pin drives a transistor, high pulls PWRKEY low
+								//0: the pin is wired to PWRKEY directly
+
+#define SIM900_FLOW UART0_FLOW	//Module runs with AT+IFC=2,2, follows the flow control of SIM900_UART
+
+
+/************************************************
+	UART FLOW CONTROL
+*************************************************/
+
+#define UART0_FLOW 0		//1: RTS/CTS of USART0 are wired, 0: not used
+
+#define UART0_RTS C		//RTS output -> PC0, low while the AVR can take data
+#define UART0_RTS_POS PC0
+
+#define UART0_CTS C		//CTS input <- PC1, low while the other side can take data
+#define UART0_CTS_POS PC1
+
+
 //************************************************
 
 #endif /* CONFIG_H_ */
\ No newline at end of file
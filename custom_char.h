@@ -4,12 +4,19 @@ Created by eXtreme Electronics
 LCD Custom Char Builder!
 
 Visit http://www.eXtremeElectronics.co.in
+
+The set lives in flash and may hold more than the 8 glyphs the LCD
+can show at once, the glyph manager in LCD.c maps them onto the CGRAM
+slots on demand. Glyph n starts at byte n*8, its order must match the
+LCD_GLYPH_xxx numbers in LCD.h.
 */
 
 #ifndef __CUSTOMCHAR_H
 #define __CUSTOMCHAR_H
 
-unsigned char __cgram[]=
+#include <avr/pgmspace.h>
+
+const unsigned char __cgram[] PROGMEM=
 {
 	0x00, 0x00, 0x04, 0x0E, 0x04, 0x00, 0x00, 0x00, //Char0 Small Dot for NW Search Display
 	0x00, 0x04, 0x0E, 0x1F, 0x0E, 0x04, 0x00, 0x00, //Char1 Big Dot for NW Search Display
@@ -19,6 +26,19 @@ unsigned char __cgram[]=
 	0x0C, 0x12, 0x12, 0x0C, 0x00, 0x00, 0x00, 0x00, //Char5 Degree Symbol
 	0x04, 0x0E, 0x1F, 0x04, 0x04, 0x04, 0x04, 0x00, //Char6 Up arrow
 	0x01, 0x02, 0x14, 0x08, 0x00, 0x00, 0x00, 0x00, //Char7 Tick mark
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, //Char8 Signal, no bar
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x18, //Char9 Signal, 1 bar
+	0x00, 0x00, 0x00, 0x00, 0x04, 0x04, 0x0C, 0x1C, //Char10 Signal, 2 bars
+	0x00, 0x00, 0x02, 0x02, 0x06, 0x06, 0x0E, 0x1E, //Char11 Signal, 3 bars
+	0x01, 0x01, 0x03, 0x03, 0x07, 0x07, 0x0F, 0x1F, //Char12 Signal, 4 bars
+	0x0E, 0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F, //Char13 Battery empty
+	0x0E, 0x1F, 0x11, 0x11, 0x1F, 0x1F, 0x1F, 0x1F, //Char14 Battery half
+	0x0E, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, //Char15 Battery full
+	0x00, 0x11, 0x1B, 0x15, 0x1B, 0x11, 0x00, 0x00, //Char16 Valve open
+	0x00, 0x11, 0x1B, 0x1F, 0x1B, 0x11, 0x00, 0x00, //Char17 Valve closed
 };
-#endif
 
+//Plain character shown in place of a glyph whose slot got evicted
+const char __cgram_alt[] PROGMEM=".ov**o^v01234_-#OX";
+
+#endif
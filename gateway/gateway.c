@@ -0,0 +1,895 @@
+/*
+ * Name: SIM900 Gateway
+ * Description: Gateway process: starts a modem process per tty, queues the messages to
+                send, hands each one to the modem with the fewest jobs in hand and merges
+                the results and the received messages into one stream.
+ * Usage: sim900_gateway [-w window] [-s socket] tty...
+                Jobs come on stdin, one a line: "<number> <text>", and from the
+                applications connected to the local socket (-s), see GW_API_xxx.
+                An application gets the results of its own jobs and, once subscribed,
+                the messages received.
+                Events go to stdout, one a line:
+                    "up <modem> <result>"               modem ready (1) or failed
+                    "done <job> <modem> <result> <mr>"  message sent (1) or failed
+                    "in <modem> <slot> <text>"          message received
+                Results are the SIM900_xxx codes. Without -s the gateway ends once stdin
+                is closed and every job has its result, with -s on SIGINT or SIGTERM;
+                the throughput per modem goes to stderr.
+                window is the number of jobs handed to a modem ahead of its results,
+                1 to GW_WINDOW.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "SIM900.h"
+#include "gateway.h"
+
+
+// Jobs queued from the inputs, the rest of the queue takes back the jobs of a modem that dies
+#define GW_QUEUE_ROOM   (GW_QUEUE - GW_MODEMS * GW_WINDOW)
+
+// epoll data: source and index
+#define GW_EV_INPUT     0
+#define GW_EV_MODEM     1
+#define GW_EV_LISTEN    2
+#define GW_EV_CLIENT    3
+
+#define GW_EV(src,i)    ((uint32_t)(src) << 16 | (i))
+#define GW_EV_SRC(ev)   ((ev) >> 16)
+#define GW_EV_INDEX(ev) ((ev) & 0xFFFF)
+
+typedef struct
+{
+    pid_t       pid;
+    int         sock;               // Socket of the modem process, -1 once it is gone
+    uint8_t     up;                 // Ready for jobs
+    uint8_t     busy;               // Jobs in hand
+    GwMsg       job[GW_WINDOW];     // The jobs in hand, given back to the queue if it dies
+    uint32_t    sent;
+    uint32_t    failed;
+    uint32_t    received;
+} GwModem;
+
+static GwModem  Gw_modem[GW_MODEMS];
+static uint8_t  Gw_modems;
+static uint8_t  Gw_window = GW_WINDOW;
+static uint8_t  Gw_next;            // Modem tried first by the next dispatch
+
+static GwMsg    Gw_queue[GW_QUEUE];
+static uint32_t Gw_head;            // Next job taken, not masked
+static uint32_t Gw_tail;            // Next job queued, not masked
+static uint32_t Gw_id;              // Id of the last job queued
+
+static char     Gw_in[4096];        // Input read, not parsed yet from Gw_in_pos on
+static size_t   Gw_in_len;
+static size_t   Gw_in_pos;
+static char     Gw_line[256];       // Input line being received
+static size_t   Gw_line_len;
+static uint8_t  Gw_input_eof;
+static uint8_t  Gw_input_wait;      // stdin is watched, there is room in the queue
+
+static struct timespec Gw_start;    // First job handed to a modem
+
+typedef struct
+{
+    int         fd;                     // -1 if the slot is free
+    uint8_t     gen;                    // Connections the slot had, tells its jobs from an old client's
+    uint8_t     subscribed;             // Takes the received messages
+    uint8_t     done;                   // Results waiting in result[]
+    GwMsg       result[GW_API_BATCH];
+} GwClient;
+
+static GwClient Gw_client[GW_API_CLIENTS];
+static int      Gw_listen = -1;
+static uint8_t  Gw_client_wait;     // Clients are watched, there is room for a batch
+static int      Gw_ep;
+static volatile sig_atomic_t Gw_stop;
+
+
+/**
+ * Name: GwSeconds
+ * Description: The function returns the time since the first job was handed to a modem.
+ * @Author: Mehdi
+ *
+ * @Return  Seconds
+*/
+
+static double GwSeconds(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (t.tv_sec - Gw_start.tv_sec) + (t.tv_nsec - Gw_start.tv_nsec) / 1e9;
+}
+
+
+/**
+ * Name: GwMicros
+ * Description: The function returns the monotonic clock in us, the time base of the
+ *              stamps the gateway and the modem processes put in the jobs.
+ * @Author: Mehdi
+ *
+ * @Return  Time (us), modulo 2^32
+*/
+
+uint32_t GwMicros(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (uint32_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+
+/**
+ * Name: GwQueue
+ * Description: The function queues a job from an input line, "<number> <text>".
+ * @Author: Mehdi
+ *
+ * @Params	line: The line, terminated
+ * @Return  0, -1 if the line is not a job or the queue is full
+*/
+
+static int GwQueue(const char *line)
+{
+    const char *text = strchr(line, ' ');
+    GwMsg *m;
+
+    if (!text || text == line || text - line >= GW_NUM_LEN || Gw_tail - Gw_head >= GW_QUEUE_ROOM)
+        return -1;
+
+    m = &Gw_queue[Gw_tail++ & (GW_QUEUE - 1)];
+    memset(m, 0, sizeof(*m));
+    m->type = GW_MSG_SEND;
+    m->id = ++Gw_id;
+    m->stamp = GwMicros();
+    memcpy(m->num, line, text - line);
+    strncpy(m->text, text + 1, GW_TEXT_LEN);
+
+    return 0;
+}
+
+
+/**
+ * Name: GwInput
+ * Description: The function reads stdin and queues the complete lines. It stops short of
+ *              a full queue, the rest waits in the pipe.
+ * @Author: Mehdi
+*/
+
+static void GwInput(void)
+{
+    while (Gw_tail - Gw_head < GW_QUEUE_ROOM)
+    {
+        if (Gw_in_pos == Gw_in_len)
+        {
+            ssize_t n = read(STDIN_FILENO, Gw_in, sizeof(Gw_in));
+
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+                Gw_input_eof = 1;
+
+            if (n <= 0)
+                return;
+
+            Gw_in_len = n;
+            Gw_in_pos = 0;
+        }
+
+        char c = Gw_in[Gw_in_pos++];
+
+        if (c == '\n')
+        {
+            Gw_line[Gw_line_len] = '\0';
+
+            if (Gw_line_len && GwQueue(Gw_line) != 0)
+                fprintf(stderr, "gateway: bad job \"%s\"\n", Gw_line);
+
+            Gw_line_len = 0;
+        } else if (c != '\r' && Gw_line_len < sizeof(Gw_line) - 1)
+            Gw_line[Gw_line_len++] = c;
+    }
+}
+
+
+/**
+ * Name: GwDispatch
+ * Description: The function hands the queued jobs to the modems. A job goes to the ready
+ *              modem with the fewest jobs in hand, the search starting after the modem
+ *              picked last so equal modems take turns.
+ * @Author: Mehdi
+*/
+
+static void GwDispatch(void)
+{
+    while (Gw_head != Gw_tail)
+    {
+        GwModem *best = NULL;
+
+        for (uint8_t i = 0; i < Gw_modems; i++)
+        {
+            GwModem *g = &Gw_modem[(Gw_next + i) % Gw_modems];
+
+            if (g->up && g->busy < Gw_window && (!best || g->busy < best->busy))
+                best = g;
+        }
+
+        if (!best)
+            return;
+
+        GwMsg *m = &Gw_queue[Gw_head & (GW_QUEUE - 1)];
+
+        if (Gw_start.tv_sec == 0)
+            clock_gettime(CLOCK_MONOTONIC, &Gw_start);
+
+        if (send(best->sock, m, sizeof(*m), MSG_NOSIGNAL) != sizeof(*m))
+            return;     // Its EOF comes next and takes it out
+
+        best->job[best->busy++] = *m;
+        Gw_head++;
+        Gw_next = (best - Gw_modem + 1) % Gw_modems;
+    }
+}
+
+
+/**
+ * Name: GwDown
+ * Description: The function takes a modem whose process ended out of service and queues
+ *              its jobs again, in front of the others.
+ * @Author: Mehdi
+ *
+ * @Params	g: The modem
+*/
+
+static void GwDown(GwModem *g)
+{
+    uint8_t index = g - Gw_modem;
+
+    close(g->sock);
+    g->sock = -1;
+    g->up = 0;
+
+    waitpid(g->pid, NULL, 0);
+
+    while (g->busy)
+        Gw_queue[--Gw_head & (GW_QUEUE - 1)] = g->job[--g->busy];
+
+    printf("up %u %d\n", index, SIM900_FAIL);
+}
+
+
+/**
+ * Name: GwWatch
+ * Description: The function sets the epoll events of a descriptor.
+ * @Author: Mehdi
+ *
+ * @Params	fd: The descriptor
+ * @Params	ev: GW_EV(source, index)
+ * @Params	in: Watch for input
+*/
+
+static void GwWatch(int fd, uint32_t ev, uint8_t in)
+{
+    struct epoll_event e = { .events = in ? EPOLLIN : 0, .data.u32 = ev };
+
+    epoll_ctl(Gw_ep, EPOLL_CTL_MOD, fd, &e);
+}
+
+
+/**
+ * Name: GwClientWatch
+ * Description: The function starts or stops watching all clients for packets. A client
+ *              that is not watched keeps its packets in its socket and waits on send.
+ * @Author: Mehdi
+ *
+ * @Params	in: Watch for input
+*/
+
+static void GwClientWatch(uint8_t in)
+{
+    if (Gw_client_wait == in)
+        return;
+
+    Gw_client_wait = in;
+
+    for (uint8_t i = 0; i < GW_API_CLIENTS; i++)
+        if (Gw_client[i].fd >= 0)
+            GwWatch(Gw_client[i].fd, GW_EV(GW_EV_CLIENT, i), in);
+}
+
+
+/**
+ * Name: GwClientClose
+ * Description: The function ends the connection of a client. Its jobs are still sent,
+ *              their results are dropped.
+ * @Author: Mehdi
+ *
+ * @Params	c: The client
+*/
+
+static void GwClientClose(GwClient *c)
+{
+    epoll_ctl(Gw_ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    c->subscribed = 0;
+    c->done = 0;
+}
+
+
+/**
+ * Name: GwClientSend
+ * Description: The function sends a packet to a client, the header and the records as they
+ *              are. A client that does not take it at once is too slow and is dropped.
+ * @Author: Mehdi
+ *
+ * @Params	c: The client
+ * @Params	h: Header, count set
+ * @Params	rec: Records
+ * @Return  0, -1 if the client was dropped
+*/
+
+static int GwClientSend(GwClient *c, const GwApiHdr *h, const GwMsg *rec)
+{
+    struct iovec iov[2] =
+    {
+        { .iov_base = (void *)h, .iov_len = sizeof(*h) },
+        { .iov_base = (void *)rec, .iov_len = h->count * sizeof(*rec) },
+    };
+    struct msghdr mh = { .msg_iov = iov, .msg_iovlen = 2 };
+
+    if (sendmsg(c->fd, &mh, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)(iov[0].iov_len + iov[1].iov_len))
+    {
+        GwClientClose(c);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Name: GwClientFlush
+ * Description: The function sends the results gathered for a client in one packet.
+ * @Author: Mehdi
+ *
+ * @Params	c: The client
+*/
+
+static void GwClientFlush(GwClient *c)
+{
+    GwApiHdr h = { .type = GW_API_DONE, .count = c->done };
+
+    if (c->fd < 0 || c->done == 0)
+        return;
+
+    c->done = 0;
+    GwClientSend(c, &h, c->result);
+}
+
+
+/**
+ * Name: GwClientResult
+ * Description: The function gathers the result of a job for the client that submitted it,
+ *              a full batch is sent at once and the rest at the end of the loop pass.
+ * @Author: Mehdi
+ *
+ * @Params	m: GW_MSG_DONE of the job
+*/
+
+static void GwClientResult(const GwMsg *m)
+{
+    uint8_t slot = m->client & 0xFF;
+    GwClient *c;
+
+    if (slot == 0)
+        return;     // Job of stdin
+
+    c = &Gw_client[slot - 1];
+
+    if (c->fd < 0 || c->gen != (m->client >> 8))
+        return;     // Its client is gone
+
+    c->result[c->done++] = *m;
+
+    if (c->done == GW_API_BATCH)
+        GwClientFlush(c);
+}
+
+
+/**
+ * Name: GwClientInbox
+ * Description: The function sends a received message to the subscribed clients.
+ * @Author: Mehdi
+ *
+ * @Params	m: GW_MSG_INBOX of the message
+*/
+
+static void GwClientInbox(const GwMsg *m)
+{
+    GwApiHdr h = { .type = GW_API_INBOX, .count = 1 };
+
+    for (uint8_t i = 0; i < GW_API_CLIENTS; i++)
+        if (Gw_client[i].fd >= 0 && Gw_client[i].subscribed)
+            GwClientSend(&Gw_client[i], &h, m);
+}
+
+
+/**
+ * Name: GwClientRead
+ * Description: The function takes a packet of a client. The records of a submit are
+ *              received straight into the free end of the queue and are queued in
+ *              place: the gateway only stamps them with their id, client and time.
+ *              Several clients can be ready in one loop pass, so the room for
+ *              GW_API_BATCH records is checked before each packet; without it the
+ *              packet stays in the socket and the clients are paused.
+ * @Author: Mehdi
+ *
+ * @Params	index: Index of the client
+*/
+
+static void GwClientRead(uint8_t index)
+{
+    GwClient *c = &Gw_client[index];
+
+    if (Gw_tail - Gw_head + GW_API_BATCH > GW_QUEUE_ROOM)
+    {
+        GwClientWatch(0);
+        return;
+    }
+
+    uint32_t t = Gw_tail & (GW_QUEUE - 1);
+    uint32_t first = (GW_QUEUE - t < GW_API_BATCH) ? GW_QUEUE - t : GW_API_BATCH;
+    GwApiHdr h;
+    struct iovec iov[3] =
+    {
+        { .iov_base = &h, .iov_len = sizeof(h) },
+        { .iov_base = &Gw_queue[t], .iov_len = first * sizeof(GwMsg) },
+        { .iov_base = &Gw_queue[0], .iov_len = (GW_API_BATCH - first) * sizeof(GwMsg) },
+    };
+    struct msghdr mh = { .msg_iov = iov, .msg_iovlen = 3 };
+    ssize_t n = recvmsg(c->fd, &mh, MSG_DONTWAIT);
+
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+
+    // Closed, or not a packet of the protocol
+    if (n < (ssize_t)sizeof(h) || (mh.msg_flags & MSG_TRUNC) ||
+        (n - sizeof(h)) != h.count * sizeof(GwMsg))
+    {
+        GwClientClose(c);
+        return;
+    }
+
+    switch (h.type)
+    {
+        case GW_API_SUBSCRIBE:
+            c->subscribed = 1;
+            break;
+
+        case GW_API_SUBMIT:
+        {
+            uint32_t now = GwMicros();
+
+            h.type = GW_API_ACCEPT;
+            h.id = Gw_id + 1;
+
+            for (uint16_t i = 0; i < h.count; i++)
+            {
+                GwMsg *m = &Gw_queue[(Gw_tail + i) & (GW_QUEUE - 1)];
+
+                m->type = GW_MSG_SEND;
+                m->id = ++Gw_id;
+                m->stamp = now;
+                m->client = c->gen << 8 | (index + 1);
+                m->num[GW_NUM_LEN - 1] = '\0';
+                m->text[GW_TEXT_LEN] = '\0';
+            }
+
+            Gw_tail += h.count;
+            h.count = 0;
+            GwClientSend(c, &h, NULL);
+            break;
+        }
+
+        default:
+            GwClientClose(c);
+    }
+}
+
+
+/**
+ * Name: GwAccept
+ * Description: The function takes a new client on the local socket.
+ * @Author: Mehdi
+*/
+
+static void GwAccept(void)
+{
+    int fd = accept4(Gw_listen, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd < 0)
+        return;
+
+    for (uint8_t i = 0; i < GW_API_CLIENTS; i++)
+    {
+        GwClient *c = &Gw_client[i];
+
+        if (c->fd >= 0)
+            continue;
+
+        struct epoll_event e = { .events = Gw_client_wait ? EPOLLIN : 0, .data.u32 = GW_EV(GW_EV_CLIENT, i) };
+
+        c->fd = fd;
+        c->gen++;
+        epoll_ctl(Gw_ep, EPOLL_CTL_ADD, fd, &e);
+        return;
+    }
+
+    close(fd);      // No free slot
+}
+
+
+/**
+ * Name: GwListen
+ * Description: The function opens the local socket of the API.
+ * @Author: Mehdi
+ *
+ * @Params	path: Path of the socket, replaced if it exists
+ * @Return  0, -1 on error (errno is set)
+*/
+
+static int GwListen(const char *path)
+{
+    struct sockaddr_un a = { .sun_family = AF_UNIX };
+    struct epoll_event e = { .events = EPOLLIN, .data.u32 = GW_EV(GW_EV_LISTEN, 0) };
+
+    if (strlen(path) >= sizeof(a.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    strcpy(a.sun_path, path);
+    unlink(path);
+
+    Gw_listen = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+    if (Gw_listen < 0 || bind(Gw_listen, (struct sockaddr *)&a, sizeof(a)) != 0 || listen(Gw_listen, GW_API_CLIENTS) != 0)
+        return -1;
+
+    for (uint8_t i = 0; i < GW_API_CLIENTS; i++)
+        Gw_client[i].fd = -1;
+
+    Gw_client_wait = 1;
+
+    return epoll_ctl(Gw_ep, EPOLL_CTL_ADD, Gw_listen, &e);
+}
+
+
+/**
+ * Name: GwEvent
+ * Description: The function takes a message of a modem process and prints its event.
+ * @Author: Mehdi
+ *
+ * @Params	g: The modem
+ * @Return  0, -1 if the process is gone
+*/
+
+static int GwEvent(GwModem *g)
+{
+    GwMsg m;
+    uint8_t i;
+
+    if (recv(g->sock, &m, sizeof(m), 0) != sizeof(m))
+        return -1;
+
+    switch (m.type)
+    {
+        case GW_MSG_UP:
+            g->up = (m.result == SIM900_OK);
+            printf("up %u %d\n", m.modem, m.result);
+            break;
+
+        case GW_MSG_DONE:
+            for (i = 0; i < g->busy && g->job[i].id != m.id; i++);
+
+            if (i == g->busy)
+                break;      // Not one of its jobs
+
+            memmove(&g->job[i], &g->job[i + 1], (--g->busy - i) * sizeof(g->job[0]));
+
+            if (m.result == SIM900_OK)
+                g->sent++;
+            else
+                g->failed++;
+
+            printf("done %u %u %d %u\n", m.id, m.modem, m.result, m.ref);
+            GwClientResult(&m);
+            break;
+
+        case GW_MSG_INBOX:
+            g->received++;
+            m.text[GW_TEXT_LEN] = '\0';
+            printf("in %u %u %s\n", m.modem, m.ref, m.text);
+            GwClientInbox(&m);
+            break;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Name: GwStart
+ * Description: The function starts the process of a modem.
+ * @Author: Mehdi
+ *
+ * @Params	g: The modem
+ * @Params	path: tty of the modem
+ * @Return  0, -1 if the process can not be started
+*/
+
+static int GwStart(GwModem *g, const char *path)
+{
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) != 0)
+        return -1;
+
+    fflush(stdout);
+
+    g->pid = fork();
+
+    if (g->pid < 0)
+    {
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    if (g->pid == 0)
+    {
+        close(sv[0]);
+        close(Gw_ep);
+
+        // The sockets of the modems started before are the gateway's
+        for (GwModem *o = Gw_modem; o < g; o++)
+            if (o->sock >= 0)
+                close(o->sock);
+
+        _exit(ModemMain(sv[1], g - Gw_modem, path));
+    }
+
+    close(sv[1]);
+    g->sock = sv[0];
+
+    return 0;
+}
+
+
+/**
+ * Name: GwReport
+ * Description: The function prints the throughput of each modem and of the gateway.
+ * @Author: Mehdi
+*/
+
+static void GwReport(void)
+{
+    double secs = Gw_start.tv_sec ? GwSeconds() : 0;
+    uint32_t sent = 0;
+
+    for (uint8_t i = 0; i < Gw_modems; i++)
+    {
+        GwModem *g = &Gw_modem[i];
+
+        fprintf(stderr, "modem %u: %u sent, %u failed, %u received\n", i, g->sent, g->failed, g->received);
+        sent += g->sent;
+    }
+
+    fprintf(stderr, "%u sent in %.2f s, %.2f msg/s over %u modems\n", sent, secs,
+            secs > 0 ? sent / secs : 0, Gw_modems);
+}
+
+
+/**
+ * Name: GwSignal
+ * Description: The SIGINT and SIGTERM handler, it ends the loop.
+ * @Author: Mehdi
+ *
+ * @Params	sig: The signal
+*/
+
+static void GwSignal(int sig)
+{
+    Gw_stop = 1;
+}
+
+
+int main(int argc, char *argv[])
+{
+    struct epoll_event ev, events[GW_MODEMS + GW_API_CLIENTS + 2];
+    struct sigaction sa = { .sa_handler = GwSignal };
+    const char *path = NULL;
+    int opt, input_file = 0;
+
+    while ((opt = getopt(argc, argv, "w:s:")) != -1)
+    {
+        if (opt == 'w' && atoi(optarg) >= 1 && atoi(optarg) <= GW_WINDOW)
+            Gw_window = atoi(optarg);
+        else if (opt == 's')
+            path = optarg;
+        else
+        {
+            fprintf(stderr, "usage: %s [-w window] [-s socket] tty...\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind == argc || argc - optind > GW_MODEMS)
+    {
+        fprintf(stderr, "usage: %s [-w window] [-s socket] tty... (1 to %u)\n", argv[0], GW_MODEMS);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    sigaction(SIGINT, &sa, NULL);       // No SA_RESTART, epoll_wait returns
+    sigaction(SIGTERM, &sa, NULL);
+
+    Gw_ep = epoll_create1(EPOLL_CLOEXEC);
+
+    for (int i = optind; i < argc; i++)
+    {
+        GwModem *g = &Gw_modem[Gw_modems];
+
+        if (GwStart(g, argv[i]) != 0)
+        {
+            perror(argv[i]);
+            return 1;
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.u32 = GW_EV(GW_EV_MODEM, Gw_modems);
+        epoll_ctl(Gw_ep, EPOLL_CTL_ADD, g->sock, &ev);
+        Gw_modems++;
+    }
+
+    if (path && GwListen(path) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    // A regular file can not be watched, it is read whenever the queue has room
+    ev.events = EPOLLIN;
+    ev.data.u32 = GW_EV(GW_EV_INPUT, 0);
+    if (epoll_ctl(Gw_ep, EPOLL_CTL_ADD, STDIN_FILENO, &ev) != 0)
+        input_file = 1;
+    else
+    {
+        fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+        Gw_input_wait = 1;
+    }
+
+    while (!Gw_stop)
+    {
+        uint8_t alive = 0, busy = 0;
+
+        for (uint8_t i = 0; i < Gw_modems; i++)
+        {
+            alive |= (Gw_modem[i].sock >= 0);
+            busy |= Gw_modem[i].busy;
+        }
+
+        if (!alive || (!path && Gw_input_eof && Gw_head == Gw_tail && !busy))
+            break;
+
+        // Lines left over when the queue filled up do not wake epoll
+        if ((input_file && !Gw_input_eof) || Gw_in_pos < Gw_in_len)
+            GwInput();
+
+        GwDispatch();
+        fflush(stdout);
+
+        for (uint8_t i = 0; i < GW_API_CLIENTS; i++)
+            GwClientFlush(&Gw_client[i]);
+
+        // A full queue stops the reading, the writers wait on their sockets
+        if (!input_file && !Gw_input_eof && Gw_input_wait != (Gw_tail - Gw_head < GW_QUEUE_ROOM))
+        {
+            Gw_input_wait = !Gw_input_wait;
+            GwWatch(STDIN_FILENO, GW_EV(GW_EV_INPUT, 0), Gw_input_wait);
+        }
+
+        if (path)
+            GwClientWatch(Gw_tail - Gw_head + GW_API_BATCH <= GW_QUEUE_ROOM);
+
+        int n = epoll_wait(Gw_ep, events, sizeof(events) / sizeof(events[0]),
+                           (input_file && !Gw_input_eof && Gw_tail - Gw_head < GW_QUEUE_ROOM) ? 0 : -1);
+
+        for (int i = 0; i < n; i++)
+        {
+            uint32_t index = GW_EV_INDEX(events[i].data.u32);
+
+            switch (GW_EV_SRC(events[i].data.u32))
+            {
+                case GW_EV_INPUT:
+                    GwInput();
+
+                    if (Gw_input_eof)
+                        epoll_ctl(Gw_ep, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+                    break;
+
+                case GW_EV_MODEM:
+                    if (Gw_modem[index].sock >= 0 && GwEvent(&Gw_modem[index]) != 0)
+                    {
+                        epoll_ctl(Gw_ep, EPOLL_CTL_DEL, Gw_modem[index].sock, NULL);
+                        GwDown(&Gw_modem[index]);
+                    }
+                    break;
+
+                case GW_EV_LISTEN:
+                    GwAccept();
+                    break;
+
+                case GW_EV_CLIENT:
+                    if (Gw_client[index].fd < 0)
+                        break;
+
+                    // A paused client is only watched for its hangup
+                    if (events[i].events & EPOLLIN)
+                        GwClientRead(index);
+                    else
+                        GwClientClose(&Gw_client[index]);
+                    break;
+            }
+        }
+    }
+
+    fflush(stdout);
+    GwReport();
+
+    if (path)
+    {
+        for (uint8_t i = 0; i < GW_API_CLIENTS; i++)
+        {
+            GwClientFlush(&Gw_client[i]);
+
+            if (Gw_client[i].fd >= 0)
+                GwClientClose(&Gw_client[i]);
+        }
+
+        close(Gw_listen);
+        unlink(path);
+    }
+
+    for (uint8_t i = 0; i < Gw_modems; i++)
+    {
+        if (Gw_modem[i].sock >= 0)
+        {
+            close(Gw_modem[i].sock);
+            waitpid(Gw_modem[i].pid, NULL, 0);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * Name: SIM900 Gateway
+ * Description: Host side SMS gateway on several SIM900 modems, built from the firmware's
+                SIM900 layer and the host HAL (hal/). The layer keeps one modem's state in
+                file scope variables and waits by polling its port, so every modem runs it
+                in a process of its own (modem.c); the gateway process (gateway.c) owns the
+                outgoing queue, hands jobs to the modem processes and merges what they
+                receive, all from one epoll loop.
+                The processes talk over SOCK_SEQPACKET socket pairs, one GwMsg a packet.
+                Applications use the local socket API (GW_API_xxx) on a Unix domain
+                SOCK_SEQPACKET socket. A packet is a GwApiHdr followed by count GwMsg
+                records, the same records the processes exchange: submitted jobs are
+                received straight into the gateway's queue and results go out from the
+                records the modems returned, nothing is encoded or decoded on the way.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef GATEWAY_H_
+#define GATEWAY_H_
+
+#include <stdint.h>
+
+#define GW_MODEMS       16      // Modems a gateway drives
+#define GW_WINDOW       2       // Jobs handed to a modem process ahead of its results
+#define GW_QUEUE        4096    // Jobs waiting for a modem, power of two
+#define GW_NUM_LEN      16      // Phone number and terminator
+#define GW_TEXT_LEN     160     // Message text, one SMS
+
+// Message types
+#define GW_MSG_UP       1       // Modem -> gateway: modem ready (result SIM900_OK) or failed
+#define GW_MSG_SEND     2       // Gateway -> modem: send text to num
+#define GW_MSG_DONE     3       // Modem -> gateway: result of a send, <mr> in ref
+#define GW_MSG_INBOX    4       // Modem -> gateway: message received, slot in ref
+
+typedef struct
+{
+    uint8_t     type;                   // GW_MSG_xxx
+    int8_t      result;                 // SIM900_xxx
+    uint8_t     ref;                    // <mr> of a sent message, slot of a received one
+    uint8_t     modem;                  // Index of the modem
+    uint32_t    id;                     // Job id, given by the gateway
+    uint32_t    stamp;                  // GwMicros() at submit; in GW_MSG_DONE, us from the
+                                        // submit to the start of the send at the modem
+    uint16_t    client;                 // API client of the job, given by the gateway
+    char        num[GW_NUM_LEN];
+    char        text[GW_TEXT_LEN + 1];
+} GwMsg;
+
+// Local socket API
+#define GW_API_CLIENTS  16      // Clients connected at a time
+#define GW_API_BATCH    64      // Records a packet carries at most
+
+#define GW_API_SUBMIT   1       // Client -> gateway: count jobs, num and text of each record set
+#define GW_API_SUBSCRIBE 2      // Client -> gateway: send the received messages too, no records
+#define GW_API_ACCEPT   3       // Gateway -> client: the jobs of a submit are queued as id,
+                                // id + 1, ... in record order, no records
+#define GW_API_DONE     4       // Gateway -> client: results of its jobs, GW_MSG_DONE records
+#define GW_API_INBOX    5       // Gateway -> subscribers: GW_MSG_INBOX records
+
+typedef struct
+{
+    uint16_t    type;                   // GW_API_xxx
+    uint16_t    count;                  // GwMsg records after the header
+    uint32_t    tag;                    // Chosen by the client, returned in the GW_API_ACCEPT
+    uint32_t    id;                     // First job id of a GW_API_ACCEPT
+} GwApiHdr;
+
+uint32_t GwMicros(void);
+int      ModemMain(int sock, uint8_t index, const char *path);
+
+#endif /* GATEWAY_H_ */
@@ -0,0 +1,56 @@
+/*
+ * Name: Host avr/io.h
+ * Description: Stand-in of avr-libc's avr/io.h for the host build of the SIM900 layer.
+                The port registers are plain bytes, the lines they would drive (PWRKEY,
+                RTS) are not wired on a USB-serial adapter.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+extern volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+extern volatile uint8_t PINA, PINB, PINC, PIND;
+
+#define _BV(bit)    (1 << (bit))
+
+#define PA0 0
+#define PA1 1
+#define PA2 2
+#define PA3 3
+#define PA4 4
+#define PA5 5
+#define PA6 6
+#define PA7 7
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PC7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+#define PINB1 1
+#define PINB2 2
+
+#endif /* HOST_AVR_IO_H_ */
@@ -0,0 +1,34 @@
+/*
+ * Name: Host avr/pgmspace.h
+ * Description: Stand-in of avr-libc's avr/pgmspace.h for the host build. There is one
+                address space, so the _P functions are the plain ones.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#define PROGMEM
+#define PGM_P               const char *
+#define PSTR(s)             (s)
+
+#define pgm_read_byte(p)    (*(const uint8_t *)(p))
+#define pgm_read_word(p)    (*(const uint16_t *)(p))
+#define pgm_read_dword(p)   (*(const uint32_t *)(p))
+
+#define memcpy_P            memcpy
+#define strcpy_P            strcpy
+#define strncpy_P           strncpy
+#define strlen_P            strlen
+#define strcmp_P            strcmp
+#define strncmp_P           strncmp
+#define strcasecmp_P        strcasecmp
+#define strncasecmp_P       strncasecmp
+#define strstr_P            strstr
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
@@ -0,0 +1,18 @@
+/*
+ * Name: Host avr/wdt.h
+ * Description: Stand-in of avr-libc's avr/wdt.h for the host build, the gateway
+                supervises its modem processes itself.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef HOST_AVR_WDT_H_
+#define HOST_AVR_WDT_H_
+
+#define WDTO_2S             7
+
+#define wdt_reset()         ((void)0)
+#define wdt_enable(t)       ((void)(t))
+#define wdt_disable()       ((void)0)
+
+#endif /* HOST_AVR_WDT_H_ */
@@ -0,0 +1,46 @@
+/*
+ * Name: Host Tick
+ * Description: Tick.h on the host monotonic clock, for the host build of the SIM900 layer.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <time.h>
+
+#include "Tick.h"
+
+
+static struct timespec Tick_start;
+
+
+/**
+ * Name: TickInit
+ * Description: The function takes the current time as tick 0.
+ * @Author: Mehdi
+*/
+
+void TickInit(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &Tick_start);
+}
+
+
+/**
+ * Name: TickNow
+ * Description: The function returns the current tick count.
+ * @Author: Mehdi
+ *
+ * @Return  Ticks since TickInit, modulo 65536
+*/
+
+uint16_t TickNow(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (uint16_t)((t.tv_sec - Tick_start.tv_sec) * TICK_HZ +
+                      (t.tv_nsec - Tick_start.tv_nsec) / (1000000000L / TICK_HZ));
+}
@@ -0,0 +1,359 @@
+/*
+ * Name: Host UART
+ * Description: UART.h on a POSIX file descriptor, for the host build of the SIM900 layer.
+                The driver polls the port in its waits, so UARTAvailable reads what the
+                descriptor holds into the receive ring and, when the ring stays empty,
+                sleeps up to UART_HOST_WAIT ms in poll() rather than spinning. Transmitted
+                bytes are gathered in the transmit ring and written when the driver turns
+                to reading, when the ring fills up and at the end of a line, so a command
+                costs one write().
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "Gen_Def.h"
+#include "uart_host.h"
+
+
+#define UART_HOST_RING  256
+
+static char uart0_rx[UART_HOST_RING];
+static char uart0_tx[UART_HOST_RING];
+
+UART UART0 = { .rx = uart0_rx, .tx = uart0_tx, .rx_mask = UART_HOST_RING - 1, .tx_mask = UART_HOST_RING - 1 };
+
+static int uart0_fd = -1;
+
+// Lines no adapter drives, written by the SIM900 layer and read by no one
+volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+volatile uint8_t PINA, PINB, PINC, PIND;
+
+
+/**
+ * Name: UARTHostWrite
+ * Description: The function writes the transmit ring to the descriptor.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+*/
+
+static void UARTHostWrite(UART *u)
+{
+    while (u->tx_tail != u->tx_head)
+    {
+        // Up to the head, or to the end of the ring if the data wraps
+        size_t len = ((u->tx_head > u->tx_tail) ? u->tx_head : UART_HOST_RING) - u->tx_tail;
+        ssize_t n = write(uart0_fd, (const char *)u->tx + u->tx_tail, len);
+
+        if (n < 0 && errno == EAGAIN)
+        {
+            struct pollfd p = { .fd = uart0_fd, .events = POLLOUT };
+
+            poll(&p, 1, UART_HOST_WAIT);
+            continue;
+        }
+
+        if (n <= 0)
+        {
+            u->tx_tail = u->tx_head;    // Port gone, the driver's waits time out
+            return;
+        }
+
+        u->tx_tail += n;
+    }
+}
+
+
+/**
+ * Name: UARTHostRead
+ * Description: The function moves the bytes the descriptor holds into the receive ring.
+ *              Bytes that do not fit stay in the descriptor.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	wait: Time (ms) to wait for a byte if there is none
+*/
+
+static void UARTHostRead(UART *u, int wait)
+{
+    uint8_t room = (u->rx_tail - u->rx_head - 1) & u->rx_mask;
+    size_t len = UART_HOST_RING - u->rx_head;
+    ssize_t n;
+
+    if (room == 0)
+        return;
+
+    if (len > room)
+        len = room;
+
+    n = read(uart0_fd, (char *)u->rx + u->rx_head, len);
+
+    if (n < 0 && errno == EAGAIN && wait)
+    {
+        struct pollfd p = { .fd = uart0_fd, .events = POLLIN };
+
+        if (poll(&p, 1, wait) > 0)
+            n = read(uart0_fd, (char *)u->rx + u->rx_head, len);
+    }
+
+    if (n > 0)
+        u->rx_head += n;
+}
+
+
+/**
+ * Name: UARTHostOpen
+ * Description: The function opens a tty or pty for a port, non-blocking.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	path: Device, ex "/dev/ttyUSB0"
+ * @Return  0, -1 if the device can not be opened (errno is set)
+*/
+
+int UARTHostOpen(UART *u, const char *path)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0)
+        return -1;
+
+    if (uart0_fd >= 0)
+        close(uart0_fd);
+
+    uart0_fd = fd;
+    u->rx_head = u->rx_tail = 0;
+    u->tx_head = u->tx_tail = 0;
+
+    return 0;
+}
+
+
+/**
+ * Name: UARTHostFd
+ * Description: The function returns the descriptor of a port, for the caller's poll().
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  Descriptor, -1 if the port is not open
+*/
+
+int UARTHostFd(UART *u)
+{
+    return uart0_fd;
+}
+
+
+/**
+ * Name: UARTInit
+ * Description: The function sets the line of an open port: raw mode and the frame format.
+ *              double_speed has no meaning on the host and is ignored. A pty takes the
+ *              settings and ignores the speed.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	baud: Baud rate
+ * @Params	data_bits: 5 to 8
+ * @Params	parity: NONE, EVEN or ODD
+ * @Params	stop_bits: 1 or 2
+ * @Params	double_speed: Ignored
+*/
+
+void UARTInit(UART *u, uint32_t baud, uint8_t data_bits, uint8_t parity, uint8_t stop_bits, uint8_t double_speed)
+{
+    static const struct { uint32_t baud; speed_t speed; } speeds[] =
+    {
+        { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 }, { 57600, B57600 }, { 115200, B115200 },
+    };
+    static const tcflag_t sizes[] = { CS5, CS6, CS7, CS8 };
+    struct termios t;
+
+    if (uart0_fd < 0 || tcgetattr(uart0_fd, &t) != 0)
+        return;
+
+    cfmakeraw(&t);
+
+    for (uint8_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+        if (speeds[i].baud == baud)
+            cfsetspeed(&t, speeds[i].speed);
+
+    t.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB | CRTSCTS);
+    t.c_cflag |= CLOCAL | CREAD | sizes[(data_bits - 5) & 3];
+
+    if (parity == EVEN)
+        t.c_cflag |= PARENB;
+    else if (parity == ODD)
+        t.c_cflag |= PARENB | PARODD;
+
+    if (stop_bits == 2)
+        t.c_cflag |= CSTOPB;
+
+    tcsetattr(uart0_fd, TCSANOW, &t);
+    tcflush(uart0_fd, TCIOFLUSH);
+}
+
+
+/**
+ * Name: UARTAvailable
+ * Description: The function returns the number of received bytes waiting to be read.
+ *              The pending output goes out first, the driver reads an answer next.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  Bytes in the receive ring
+*/
+
+uint8_t UARTAvailable(UART *u)
+{
+    UARTHostWrite(u);
+
+    if (u->rx_head == u->rx_tail)
+        UARTHostRead(u, UART_HOST_WAIT);
+
+    return (u->rx_head - u->rx_tail) & u->rx_mask;
+}
+
+
+/**
+ * Name: UARTGetc
+ * Description: The function takes the next received byte.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  The byte, '\0' if nothing was received
+*/
+
+char UARTGetc(UART *u)
+{
+    char c;
+
+    if (u->rx_head == u->rx_tail)
+        UARTHostRead(u, 0);
+
+    if (u->rx_head == u->rx_tail)
+        return '\0';
+
+    c = u->rx[u->rx_tail];
+    u->rx_tail = (u->rx_tail + 1) & u->rx_mask;
+
+    return c;
+}
+
+
+/**
+ * Name: UARTPeek
+ * Description: The function returns the next received byte without taking it.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  The byte, '\0' if nothing was received
+*/
+
+char UARTPeek(UART *u)
+{
+    if (u->rx_head == u->rx_tail)
+        UARTHostRead(u, 0);
+
+    if (u->rx_head == u->rx_tail)
+        return '\0';
+
+    return u->rx[u->rx_tail];
+}
+
+
+/**
+ * Name: UARTTxRoom
+ * Description: The function returns the number of bytes UARTPutc takes without waiting.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Return  Free bytes in the transmit ring
+*/
+
+uint8_t UARTTxRoom(UART *u)
+{
+    return (u->tx_tail - u->tx_head - 1) & u->tx_mask;
+}
+
+
+/**
+ * Name: UARTPutc
+ * Description: The function queues a byte for transmission. The ring is written out
+ *              when it is full and after a CR, Ctrl-Z or ESC, the bytes that end a
+ *              command or a message body.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	c: Byte to send
+*/
+
+void UARTPutc(UART *u, char c)
+{
+    if (UARTTxRoom(u) == 0)
+        UARTHostWrite(u);
+
+    u->tx[u->tx_head] = c;
+    u->tx_head = (u->tx_head + 1) & u->tx_mask;
+
+    if (c == 0x0D || c == 0x1A || c == 0x1B)
+        UARTHostWrite(u);
+}
+
+
+/**
+ * Name: UARTPuts
+ * Description: The function queues a string for transmission.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	s: String
+*/
+
+void UARTPuts(UART *u, const char *s)
+{
+    while (*s)
+        UARTPutc(u, *s++);
+}
+
+
+/**
+ * Name: UARTPutsF
+ * Description: The function queues a string kept in flash for transmission, the same
+ *              as UARTPuts on the host.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+ * @Params	s: String
+*/
+
+void UARTPutsF(UART *u, const char *s)
+{
+    UARTPuts(u, s);
+}
+
+
+/**
+ * Name: UARTFlush
+ * Description: The function drops the received bytes not read yet, the ones still in
+ *              the descriptor too.
+ * @Author: Mehdi
+ *
+ * @Params	u: Port
+*/
+
+void UARTFlush(UART *u)
+{
+    u->rx_tail = u->rx_head;
+
+    if (uart0_fd >= 0)
+        tcflush(uart0_fd, TCIFLUSH);
+}
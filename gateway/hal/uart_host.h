@@ -0,0 +1,19 @@
+/*
+ * Name: Host UART
+ * Description: Host side of UART.h. A port is bound to a file descriptor (a tty of a
+                USB-serial adapter, or a pty of the modem emulator) instead of a USART.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef UART_HOST_H_
+#define UART_HOST_H_
+
+#include "UART.h"
+
+#define UART_HOST_WAIT  1       // Time (ms) UARTAvailable sleeps on an empty port
+
+int  UARTHostOpen(UART *u, const char *path);
+int  UARTHostFd(UART *u);
+
+#endif /* UART_HOST_H_ */
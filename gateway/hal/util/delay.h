@@ -0,0 +1,16 @@
+/*
+ * Name: Host util/delay.h
+ * Description: Stand-in of avr-libc's util/delay.h for the host build.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#include <unistd.h>
+
+#define _delay_ms(ms)       usleep((useconds_t)(ms) * 1000)
+#define _delay_us(us)       usleep((useconds_t)(us))
+
+#endif /* HOST_UTIL_DELAY_H_ */
@@ -0,0 +1,258 @@
+/*
+ * Name: SIM900 Gateway Load
+ * Description: Load generator of the gateway's local socket API. It submits jobs in
+                batches, keeps up to -o of them without a result and reports the
+                latencies, in ms:
+                    accept      submit sent to GW_API_ACCEPT received, per packet
+                    to modem    submit received to the send started at a modem, from
+                                the stamp of each GW_API_DONE record (gateway clock)
+                    result      submit sent to GW_API_DONE received, per job
+ * Usage: sim900_load -s socket [-n jobs] [-b batch] [-o outstanding] [-i]
+                -i subscribes to the received messages and counts them.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "SIM900.h"
+#include "gateway.h"
+
+
+typedef struct
+{
+    uint32_t    first_id;   // Id of the first job, 0 until accepted
+    uint16_t    count;
+    double      sent;       // Time (ms) the submit was sent
+} packet_t;
+
+static packet_t *packets;
+static int      packet_count;       // Packets sent
+static int      accepted;           // Packets accepted, they are accepted in order
+
+static double   *lat_accept, *lat_modem, *lat_result;
+static int      results, failures, inbound;
+
+static double now_ms(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+static int cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void print_lat(const char *name, double *v, int n)
+{
+    double sum = 0;
+
+    if (n == 0)
+        return;
+
+    qsort(v, n, sizeof(v[0]), cmp);
+
+    for (int i = 0; i < n; i++)
+        sum += v[i];
+
+    printf("%-10s min %8.2f  avg %8.2f  p50 %8.2f  p99 %8.2f  max %8.2f ms  (%d)\n", name,
+           v[0], sum / n, v[n / 2], v[(int)(n * 0.99)], v[n - 1], n);
+}
+
+// Packet of the job with this id
+static packet_t *find_packet(uint32_t id)
+{
+    int lo = 0, hi = accepted;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+
+        if (packets[mid].first_id + packets[mid].count <= id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return (lo < accepted && id >= packets[lo].first_id) ? &packets[lo] : NULL;
+}
+
+static int submit(int fd, int first, int count)
+{
+    GwMsg rec[GW_API_BATCH];
+    GwApiHdr h = { .type = GW_API_SUBMIT, .count = count, .tag = packet_count };
+    struct iovec iov[2] = { { &h, sizeof(h) }, { rec, count * sizeof(rec[0]) } };
+    struct msghdr mh = { .msg_iov = iov, .msg_iovlen = 2 };
+
+    memset(rec, 0, count * sizeof(rec[0]));
+
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(rec[i].num, sizeof(rec[i].num), "+98912%07d", first + i);
+        snprintf(rec[i].text, sizeof(rec[i].text), "Load %d", first + i);
+    }
+
+    packets[packet_count].count = count;
+    packets[packet_count].sent = now_ms();
+
+    if (sendmsg(fd, &mh, 0) < 0)
+        return -1;
+
+    packet_count++;
+    return 0;
+}
+
+static int receive(int fd)
+{
+    static struct { GwApiHdr h; GwMsg rec[GW_API_BATCH]; } p;
+    ssize_t n = recv(fd, &p, sizeof(p), 0);
+    double t = now_ms();
+
+    if (n < (ssize_t)sizeof(p.h))
+        return -1;
+
+    switch (p.h.type)
+    {
+        case GW_API_ACCEPT:
+            if (p.h.tag != (uint32_t)accepted)
+                return -1;      // Out of order
+
+            packets[accepted].first_id = p.h.id;
+            lat_accept[accepted] = t - packets[accepted].sent;
+            accepted++;
+            break;
+
+        case GW_API_DONE:
+            for (int i = 0; i < p.h.count; i++)
+            {
+                packet_t *k = find_packet(p.rec[i].id);
+
+                if (!k)
+                    continue;
+
+                lat_modem[results] = p.rec[i].stamp / 1e3;
+                lat_result[results] = t - k->sent;
+                failures += (p.rec[i].result != SIM900_OK);
+                results++;
+            }
+            break;
+
+        case GW_API_INBOX:
+            inbound += p.h.count;
+            break;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un a = { .sun_family = AF_UNIX };
+    const char *path = NULL;
+    int jobs = 256, batch = 16, window = 64, subscribe = 0;
+    int opt, fd, submitted = 0;
+    double start, secs;
+
+    while ((opt = getopt(argc, argv, "s:n:b:o:i")) != -1)
+    {
+        switch (opt)
+        {
+            case 's': path = optarg; break;
+            case 'n': jobs = atoi(optarg); break;
+            case 'b': batch = atoi(optarg); break;
+            case 'o': window = atoi(optarg); break;
+            case 'i': subscribe = 1; break;
+            default: path = NULL; optind = argc + 1;
+        }
+    }
+
+    if (!path || optind > argc || jobs < 1 || batch < 1 || batch > GW_API_BATCH || window < batch ||
+        strlen(path) >= sizeof(a.sun_path))
+    {
+        fprintf(stderr, "usage: %s -s socket [-n jobs] [-b batch 1..%d] [-o outstanding] [-i]\n",
+                argv[0], GW_API_BATCH);
+        return 1;
+    }
+
+    packets = calloc(jobs, sizeof(*packets));
+    lat_accept = calloc(jobs, sizeof(double));
+    lat_modem = calloc(jobs, sizeof(double));
+    lat_result = calloc(jobs, sizeof(double));
+
+    strcpy(a.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+
+    if (fd < 0 || connect(fd, (struct sockaddr *)&a, sizeof(a)) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    if (subscribe)
+    {
+        GwApiHdr h = { .type = GW_API_SUBSCRIBE };
+
+        send(fd, &h, sizeof(h), 0);
+    }
+
+    start = now_ms();
+
+    while (results < jobs)
+    {
+        struct pollfd p = { .fd = fd, .events = POLLIN };
+
+        while (submitted < jobs && submitted - results + batch <= window)
+        {
+            int count = (jobs - submitted < batch) ? jobs - submitted : batch;
+
+            if (submit(fd, submitted, count) != 0)
+            {
+                perror("submit");
+                return 1;
+            }
+
+            submitted += count;
+        }
+
+        if (poll(&p, 1, -1) < 0 && errno != EINTR)
+            break;
+
+        if ((p.revents & POLLIN) && receive(fd) != 0)
+        {
+            fprintf(stderr, "load: gateway closed the connection\n");
+            break;
+        }
+    }
+
+    secs = (now_ms() - start) / 1e3;
+
+    printf("%d jobs, %d results (%d failed) in %.2f s, %.2f msg/s, batch %d, outstanding %d\n",
+           jobs, results, failures, secs, results / secs, batch, window);
+    print_lat("accept", lat_accept, accepted);
+    print_lat("to modem", lat_modem, results);
+    print_lat("result", lat_result, results);
+
+    if (subscribe)
+        printf("%d messages received\n", inbound);
+
+    close(fd);
+
+    return results == jobs ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/*
+ * Name: Modem Process
+ * Description: One modem of the gateway. It runs the SIM900 layer on the modem's tty: boots
+                and sets the module up, sends the jobs the gateway hands over and passes on
+                the messages the module receives, deleting them once they are out.
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "Gen_Def.h"
+#include "config.h"
+#include "UART.h"
+#include "Tick.h"
+#include "SIM900.h"
+#include "uart_host.h"
+#include "gateway.h"
+
+
+typedef struct
+{
+    char    *p;         // Where the next chunk goes
+    uint8_t room;       // Chars left
+} ModemText;
+
+
+/**
+ * Name: ModemReply
+ * Description: The function sends a message to the gateway.
+ * @Author: Mehdi
+ *
+ * @Params	sock: Socket of the gateway
+ * @Params	m: The message
+ * @Return  0, -1 if the gateway is gone
+*/
+
+static int ModemReply(int sock, const GwMsg *m)
+{
+    return (send(sock, m, sizeof(*m), MSG_NOSIGNAL) == sizeof(*m)) ? 0 : -1;
+}
+
+
+/**
+ * Name: ModemBody
+ * Description: The SIM900ReadMsgStream consumer, it copies the body into the inbox message.
+ * @Author: Mehdi
+ *
+ * @Params	chunk: Body chars
+ * @Params	len: Chars in chunk
+ * @Params	ctx: ModemText
+*/
+
+static void ModemBody(const char *chunk, uint8_t len, void *ctx)
+{
+    ModemText *t = ctx;
+
+    if (len > t->room)
+        len = t->room;
+
+    memcpy(t->p, chunk, len);
+    t->p += len;
+    t->room -= len;
+    *t->p = '\0';
+}
+
+
+/**
+ * Name: ModemInbox
+ * Description: The function passes the stored messages on to the gateway and deletes
+ *              them. Redelivered copies are deleted only.
+ * @Author: Mehdi
+ *
+ * @Params	sock: Socket of the gateway
+ * @Params	index: Index of the modem
+ * @Return  0, -1 if the gateway is gone
+*/
+
+static int ModemInbox(int sock, uint8_t index)
+{
+    GwMsg m;
+    uint8_t id;
+
+    while (SIM900NextMsg(1, &id) == SIM900_OK)
+    {
+        ModemText t = { m.text, GW_TEXT_LEN };
+
+        memset(&m, 0, sizeof(m));
+        m.type = GW_MSG_INBOX;
+        m.modem = index;
+        m.ref = id;
+        m.result = SIM900ReadMsgStream(id, ModemBody, &t);
+
+        if (m.result == SIM900_OK && ModemReply(sock, &m) != 0)
+            return -1;
+
+        if (m.result == SIM900_MSG_EMPTY)
+            continue;       // Slot cleared by the read
+
+        if (m.result != SIM900_OK && m.result != SIM900_MSG_DUPLICATE)
+            break;          // Left in the map, the next pass tries again
+
+        if (SIM900DeleteMsg(id) != SIM900_OK)
+            break;
+    }
+
+    return 0;
+}
+
+
+/**
+ * Name: ModemMain
+ * Description: The function runs a modem until the gateway closes its socket. Jobs come
+ *              in GW_MSG_SEND messages, up to GW_WINDOW of them wait here; each gets a
+ *              GW_MSG_DONE with the result and the <mr> of the message. Between jobs the
+ *              port is watched for +CMTI and the storage and liveness tasks run.
+ * @Author: Mehdi
+ *
+ * @Params	sock: Socket of the gateway
+ * @Params	index: Index of the modem, copied into the messages
+ * @Params	path: tty of the modem
+ * @Return  Exit status of the process
+*/
+
+int ModemMain(int sock, uint8_t index, const char *path)
+{
+    GwMsg job[GW_WINDOW], m;
+    uint8_t jobs = 0;
+
+    memset(&m, 0, sizeof(m));
+    m.type = GW_MSG_UP;
+    m.modem = index;
+
+    TickInit();
+
+    if (UARTHostOpen(&SIM900_UART, path) != 0)
+    {
+        m.result = SIM900_FAIL;
+        ModemReply(sock, &m);
+        return 1;
+    }
+
+    UARTInit(&SIM900_UART, 9600, 8, NONE, 1, 0);
+
+    SIM900BootStart();
+
+    while (SIM900BootTask() == SIM900_BUSY);
+
+    m.result = SIM900Init();
+
+    if (ModemReply(sock, &m) != 0 || m.result != SIM900_OK)
+        return 1;
+
+    for (;;)
+    {
+        struct pollfd p[2] =
+        {
+            { .fd = sock, .events = POLLIN },
+            { .fd = UARTHostFd(&SIM900_UART), .events = POLLIN },
+        };
+
+        // No timeout while jobs wait, the idle tasks run once a second at least
+        poll(p, 2, jobs ? 0 : 1000);
+
+        if (p[0].revents & POLLIN)
+        {
+            if (recv(sock, &m, sizeof(m), 0) != sizeof(m))
+                return 0;       // Gateway gone
+
+            if (m.type == GW_MSG_SEND && jobs < GW_WINDOW)
+                job[jobs++] = m;
+        } else if (p[0].revents & (POLLHUP | POLLERR))
+            return 0;
+
+        if (jobs)
+        {
+            m = job[0];
+            m.type = GW_MSG_DONE;
+            m.modem = index;
+            m.ref = 0;
+            m.stamp = GwMicros() - job[0].stamp;
+            m.result = SIM900SendMsg(job[0].num, job[0].text, &m.ref);
+            m.text[0] = '\0';
+
+            memmove(&job[0], &job[1], --jobs * sizeof(job[0]));
+
+            if (ModemReply(sock, &m) != 0)
+                return 0;
+
+            // The +CMTI that came meanwhile are in the storage map, a send and a read take turns
+            if (ModemInbox(sock, index) != 0)
+                return 0;
+
+            continue;
+        }
+
+        // URCs: +CMTI marks the slot, +CDS and +CREG update the layer's state
+        if (UARTAvailable(&SIM900_UART))
+        {
+            uint8_t id;
+
+            SIM900WaitForMsg(&id);
+        }
+
+        if (ModemInbox(sock, index) != 0)
+            return 0;
+
+        SIM900StorageTask();
+        SIM900LivenessTask();
+    }
+}
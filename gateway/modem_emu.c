@@ -0,0 +1,405 @@
+/*
+ * Name: SIM900 Emulator
+ * Description: Several SIM900 modems on pseudo terminals, to run the gateway without the
+                hardware. Each pty answers the commands of the SIM900 layer the way the
+                bench's virtual modem does, with the module's latencies: it is already on,
+                sends a message in -s ms and, every -i ms, one of the modems receives a
+                message (+CMTI, read with AT+CMGR, deleted with AT+CMGD).
+ * Usage: sim900_emu [-n modems] [-s send_ms] [-i inbound_ms]
+                The pty names are printed on stdout, one a line, then the modems run
+                until the process is ended (SIGINT, SIGTERM); the counts per modem go
+                to stderr.
+                ex: sim900_emu -n 4 > ptys & sleep 1; sim900_gateway $(cat ptys) < jobs
+ * Created: 10/19/2026
+ * Author : Mehdi
+ */
+
+
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <termios.h>
+
+
+#define EMU_MODEMS          16
+#define EMU_SLOTS           30      // Message memory
+#define EMU_SEGMENTS        16
+
+// Latencies (ms), those of the bench's virtual modem
+#define LAT_AT              10
+#define LAT_CREG            20
+#define LAT_CMGR            40
+#define LAT_CMGD            40
+#define LAT_PROMPT          50
+
+typedef struct
+{
+    char        text[256];
+    uint64_t    due;        // Time (ms) from which the text may be sent
+} segment_t;
+
+typedef struct
+{
+    int         fd;                             // pty master
+    char        name[64];                       // pty slave
+    segment_t   seg[EMU_SEGMENTS];
+    uint8_t     seg_head, seg_count;
+    char        line[512];
+    uint16_t    line_len;
+    uint8_t     in_body;                        // Receiving an SMS body after the '>' prompt
+    uint8_t     echo;
+    uint8_t     profile;
+    uint8_t     msg_ref;
+    char        slot[EMU_SLOTS][64];            // Stored messages, empty if free
+    uint32_t    sent, received, dropped;
+} modem_t;
+
+static modem_t      modems[EMU_MODEMS];
+static int          modem_count = 4;
+static uint64_t     lat_send = 1500;
+static uint64_t     inbound_period;
+static volatile int done;
+
+static uint64_t now_ms(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+static void modem_send(modem_t *m, const char *text, uint64_t delay)
+{
+    if (m->seg_count == EMU_SEGMENTS)
+    {
+        fprintf(stderr, "emu: reply queue of %s full\n", m->name);
+        return;
+    }
+
+    segment_t *s = &m->seg[(m->seg_head + m->seg_count++) % EMU_SEGMENTS];
+    uint64_t due = now_ms() + delay;
+
+    // Replies leave in order
+    if (m->seg_count > 1)
+    {
+        segment_t *prev = &m->seg[(m->seg_head + m->seg_count - 2) % EMU_SEGMENTS];
+
+        if (due < prev->due)
+            due = prev->due;
+    }
+
+    snprintf(s->text, sizeof(s->text), "%s", text);
+    s->due = due;
+}
+
+static void modem_inbound(modem_t *m, uint32_t seq)
+{
+    char urc[32];
+
+    for (int i = 0; i < EMU_SLOTS; i++)
+    {
+        if (m->slot[i][0])
+            continue;
+
+        snprintf(m->slot[i], sizeof(m->slot[i]), "Inbound %u", seq);
+        snprintf(urc, sizeof(urc), "\r\n+CMTI: \"ME\",%d\r\n", i + 1);
+        modem_send(m, urc, 0);
+        m->received++;
+        return;
+    }
+
+    m->dropped++;    // Memory full
+}
+
+static void modem_line(modem_t *m, const char *cmd)
+{
+    char text[sizeof(m->line) + 128];
+    int used = 0;
+
+    if (m->echo)
+    {
+        snprintf(text, sizeof(text), "%s\r", cmd);
+        modem_send(m, text, 0);
+    }
+
+    for (int i = 0; i < EMU_SLOTS; i++)
+        used += m->slot[i][0] != 0;
+
+    if (strcasecmp(cmd, "AT+CPIN?;+CFUN?;+CCALR?") == 0)
+        modem_send(m, "\r\n+CPIN: READY\r\n\r\n+CFUN: 1\r\n\r\n+CCALR: 1\r\n\r\nOK\r\n", LAT_AT);
+    else if (strncasecmp(cmd, "AT+CMGF?;+CNMI?;+CMEE?;+CSCS?;+CSMP?", 36) == 0)
+    {
+        if (m->profile)
+            modem_send(m, "\r\n+CMGF: 1\r\n\r\n+CNMI: 2,1,0,1,0\r\n\r\n+CMEE: 1\r\n"
+                       "\r\n+CSCS: \"GSM\"\r\n\r\n+CSMP: 49,167,0,0\r\n", LAT_AT);
+        else
+            modem_send(m, "\r\n+CMGF: 0\r\n\r\n+CNMI: 0,0,0,0,0\r\n\r\n+CMEE: 0\r\n"
+                       "\r\n+CSCS: \"IRA\"\r\n\r\n+CSMP: 17,167,0,0\r\n", LAT_AT);
+
+        if (cmd[36])
+            modem_send(m, m->profile ? "\r\n+IFC: 2,2\r\n" : "\r\n+IFC: 0,0\r\n", 0);
+
+        modem_send(m, "\r\nOK\r\n", 0);
+    }
+    else if (strncasecmp(cmd, "ATE0+CMGF=1;", 12) == 0)
+    {
+        m->echo = 0;
+        m->profile = 1;
+        modem_send(m, "\r\nOK\r\n", LAT_AT);
+    }
+    else if (strcasecmp(cmd, "AT") == 0 || strcasecmp(cmd, "AT&W") == 0 || strcasecmp(cmd, "AT+CREG=1") == 0)
+        modem_send(m, "\r\nOK\r\n", LAT_AT);
+    else if (strcasecmp(cmd, "AT+CREG?") == 0)
+        modem_send(m, "\r\n+CREG: 1,1\r\n\r\nOK\r\n", LAT_CREG);
+    else if (strcasecmp(cmd, "AT+CSQ") == 0)
+        modem_send(m, "\r\n+CSQ: 18,0\r\n\r\nOK\r\n", LAT_AT);
+    else if (strncasecmp(cmd, "AT+CPMS=", 8) == 0)
+    {
+        snprintf(text, sizeof(text), "\r\n+CPMS: %d,%d,%d,%d,%d,%d\r\n\r\nOK\r\n",
+                 used, EMU_SLOTS, used, EMU_SLOTS, used, EMU_SLOTS);
+        modem_send(m, text, LAT_AT);
+    }
+    else if (strncasecmp(cmd, "AT+CMGL=", 8) == 0)
+    {
+        for (int i = 0; i < EMU_SLOTS; i++)
+        {
+            if (!m->slot[i][0])
+                continue;
+
+            snprintf(text, sizeof(text), "\r\n+CMGL: %d,\"REC UNREAD\",\"+989120000000\",,"
+                     "\"26/10/19,12:00:00+14\"\r\n%s\r\n", i + 1, m->slot[i]);
+            modem_send(m, text, 0);
+        }
+        modem_send(m, "\r\nOK\r\n", LAT_CMGD);
+    }
+    else if (strncasecmp(cmd, "AT+CMGDA=", 9) == 0)
+        modem_send(m, "\r\nOK\r\n", LAT_CMGD);     // Read messages are deleted one by one
+    else if (strncasecmp(cmd, "AT+CMGR=", 8) == 0)
+    {
+        int slot = atoi(cmd + 8);
+
+        if (slot < 1 || slot > EMU_SLOTS)
+            modem_send(m, "\r\n+CMS ERROR: 321\r\n", LAT_AT);
+        else if (!m->slot[slot - 1][0])
+            modem_send(m, "\r\nOK\r\n", LAT_CMGR);
+        else
+        {
+            // A time stamp per modem and slot content, no message looks redelivered
+            snprintf(text, sizeof(text), "\r\n+CMGR: \"REC UNREAD\",\"+989120000000\",,"
+                     "\"26/10/19,12:00:00+14\"\r\n%s %d\r\n\r\nOK\r\n", m->slot[slot - 1], (int)(m - modems));
+            modem_send(m, text, LAT_CMGR);
+        }
+    }
+    else if (strncasecmp(cmd, "AT+CMGD=", 8) == 0)
+    {
+        int slot = atoi(cmd + 8);
+
+        if (slot >= 1 && slot <= EMU_SLOTS)
+            m->slot[slot - 1][0] = '\0';
+        modem_send(m, "\r\nOK\r\n", LAT_CMGD);
+    }
+    else if (strncasecmp(cmd, "AT+CMGS=", 8) == 0)
+    {
+        modem_send(m, "\r\n> ", LAT_PROMPT);
+        m->in_body = 1;
+    }
+    else if (strncasecmp(cmd, "AT+CFUN=1,1", 11) == 0)
+    {
+        m->echo = 1;
+        m->profile = 0;
+        modem_send(m, "\r\nOK\r\n", LAT_AT);
+        modem_send(m, "\r\nRDY\r\n\r\n+CFUN: 1\r\n\r\n+CPIN: READY\r\n\r\nCall Ready\r\n", 2000);
+    }
+    else
+        modem_send(m, "\r\nERROR\r\n", LAT_AT);
+}
+
+// Bytes written by the gateway
+static void modem_input(modem_t *m)
+{
+    char buf[256], text[128];
+    ssize_t n = read(m->fd, buf, sizeof(buf));
+
+    for (ssize_t i = 0; i < n; i++)
+    {
+        char c = buf[i];
+
+        if (m->in_body)
+        {
+            if (c == 0x1A)
+            {
+                m->in_body = 0;
+                m->msg_ref++;
+                m->sent++;
+                snprintf(text, sizeof(text), "\r\n+CMGS: %u\r\n\r\nOK\r\n", m->msg_ref);
+                modem_send(m, text, lat_send);
+
+                snprintf(text, sizeof(text), "\r\n+CDS: 6,%u,\"+989120000000\",145,"
+                         "\"26/10/19,12:00:00+14\",\"26/10/19,12:00:02+14\",0\r\n", m->msg_ref);
+                modem_send(m, text, 0);
+            } else if (c == 0x1B)
+            {
+                m->in_body = 0;
+                modem_send(m, "\r\nOK\r\n", 0);
+            }
+            continue;
+        }
+
+        if (c == '\r')
+        {
+            m->line[m->line_len] = '\0';
+            if (m->line_len)
+                modem_line(m, m->line);
+            m->line_len = 0;
+        } else if (c != '\n' && m->line_len < sizeof(m->line) - 1)
+            m->line[m->line_len++] = c;
+    }
+}
+
+// Writes the due replies, returns the time (ms) to the next one, -1 if none
+static int modem_output(modem_t *m, uint64_t t)
+{
+    while (m->seg_count)
+    {
+        segment_t *s = &m->seg[m->seg_head];
+
+        if (s->due > t)
+            return s->due - t;
+
+        if (write(m->fd, s->text, strlen(s->text)) < 0)
+            return -1;
+
+        m->seg_head = (m->seg_head + 1) % EMU_SEGMENTS;
+        m->seg_count--;
+    }
+
+    return -1;
+}
+
+static int modem_open(modem_t *m)
+{
+    struct termios t;
+
+    m->fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (m->fd < 0 || grantpt(m->fd) != 0 || unlockpt(m->fd) != 0 || ptsname_r(m->fd, m->name, sizeof(m->name)) != 0)
+        return -1;
+
+    // Raw both ways, the gateway sets its side too but may open it later
+    if (tcgetattr(m->fd, &t) == 0)
+    {
+        cfmakeraw(&t);
+        tcsetattr(m->fd, TCSANOW, &t);
+    }
+
+    m->echo = 1;
+
+    return 0;
+}
+
+static void stop(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char *argv[])
+{
+    struct epoll_event ev, events[EMU_MODEMS];
+    uint64_t next_inbound = 0;
+    uint32_t inbound_seq = 0;
+    int opt, ep;
+
+    while ((opt = getopt(argc, argv, "n:s:i:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': modem_count = atoi(optarg); break;
+            case 's': lat_send = strtoull(optarg, NULL, 10); break;
+            case 'i': inbound_period = strtoull(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "usage: %s [-n modems] [-s send_ms] [-i inbound_ms]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (modem_count < 1 || modem_count > EMU_MODEMS)
+    {
+        fprintf(stderr, "emu: 1 to %d modems\n", EMU_MODEMS);
+        return 1;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    ep = epoll_create1(0);
+
+    for (int i = 0; i < modem_count; i++)
+    {
+        if (modem_open(&modems[i]) != 0)
+        {
+            perror("emu: pty");
+            return 1;
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = &modems[i];
+        epoll_ctl(ep, EPOLL_CTL_ADD, modems[i].fd, &ev);
+        printf("%s\n", modems[i].name);
+    }
+
+    fflush(stdout);
+
+    if (inbound_period)
+        next_inbound = now_ms() + inbound_period;
+
+    while (!done)
+    {
+        uint64_t t = now_ms();
+        int timeout = -1;
+
+        if (inbound_period && t >= next_inbound)
+        {
+            modem_inbound(&modems[inbound_seq % modem_count], inbound_seq);
+            inbound_seq++;
+            next_inbound += inbound_period;
+        }
+
+        for (int i = 0; i < modem_count; i++)
+        {
+            int w = modem_output(&modems[i], t);
+
+            if (w >= 0 && (timeout < 0 || w < timeout))
+                timeout = w;
+        }
+
+        if (inbound_period && (timeout < 0 || next_inbound - t < (uint64_t)timeout))
+            timeout = next_inbound > t ? next_inbound - t : 0;
+
+        int n = epoll_wait(ep, events, EMU_MODEMS, timeout);
+
+        for (int i = 0; i < n; i++)
+        {
+            modem_t *m = events[i].data.ptr;
+
+            if (events[i].events & EPOLLIN)
+                modem_input(m);
+            else if (events[i].events & EPOLLHUP)
+                usleep(1000);   // Slave not open (yet, or any more)
+        }
+    }
+
+    for (int i = 0; i < modem_count; i++)
+        fprintf(stderr, "emu %s: %u sent, %u received, %u dropped\n", modems[i].name,
+                modems[i].sent, modems[i].received, modems[i].dropped);
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+#
+# Name: Memory Map
+# Description: SRAM/flash report of the firmware image, run by "make memmap".
+#              Input: "avr-nm -S -t d" of the ELF file, then the call graph files (.ci) GCC
+#              writes with -fcallgraph-info=su. Prints the symbols by memory, largest first,
+#              and the worst-case stack: the deepest call chain from main plus the deepest
+#              interrupt handler on top of it (the ISRs do not nest).
+#              Variables: RAM (SRAM size in bytes), RET (bytes a call pushes, 2 or 3).
+# Created: 10/19/2026
+# Author : Mehdi
+#
+
+# Quoted value of a "key: "value"" field of a .ci line
+function field(key,    s)
+{
+    if (!match($0, key ": \"[^\"]*\""))
+        return ""
+
+    s = substr($0, RSTART + length(key) + 3, RLENGTH - length(key) - 4)
+    return s
+}
+
+# Stack used by f and the deepest chain it calls, the chain is kept in deeper[]
+function depth(f,    list, n, i, d, best)
+{
+    if (f in memo)
+        return memo[f]
+
+    if (f in busy)
+    {
+        recursive[f] = 1        # Recursion, counted once
+        return 0
+    }
+
+    busy[f] = 1
+    best = 0
+
+    n = split(calls[f], list, " ")
+    for (i = 1; i <= n; i++)
+    {
+        d = depth(list[i]) + RET
+        if (d > best)
+        {
+            best = d
+            deeper[f] = list[i]
+        }
+    }
+
+    delete busy[f]
+
+    if (!(f in frame) && f != "")
+        unknown[f] = 1
+
+    memo[f] = frame[f] + best
+    return memo[f]
+}
+
+function chain(f,    s)
+{
+    s = f "(" frame[f] ")"
+    while (f in deeper)
+    {
+        f = deeper[f]
+        s = s " > " f "(" frame[f] ")"
+    }
+    return s
+}
+
+BEGIN {
+    if (RET == "")
+        RET = 2
+}
+
+# avr-nm: address size type name, SRAM is mapped from 0x800000, EEPROM from 0x810000
+FILENAME == "-" && NF == 4 {
+    if ($1 >= 8388608 && $1 < 8454144)
+    {
+        sram[++nsram] = sprintf("%6d  %s", $2, $4)
+        sram_used += $2
+    } else if ($1 < 8388608)
+    {
+        flash[++nflash] = sprintf("%6d  %s", $2, $4)
+        flash_used += $2
+    }
+    next
+}
+
+FILENAME != "-" && /^node:/ {
+    name = field("title")
+    if (match($0, /[0-9]+ bytes/))
+        frame[name] = substr($0, RSTART, RLENGTH) + 0
+    if (name ~ /^__vector_/)
+        isr[name] = 1
+    next
+}
+
+FILENAME != "-" && /^edge:/ {
+    calls[field("sourcename")] = calls[field("sourcename")] " " field("targetname")
+    next
+}
+
+END {
+    # avr-nm -S --size-sort -r lists the largest symbols first
+    print "SRAM (.data, .bss, .noinit): " sram_used " bytes"
+    for (i = 1; i <= nsram; i++)
+        print sram[i]
+
+    print ""
+    print "Flash (code, PROGMEM): " flash_used " bytes"
+    for (i = 1; i <= nflash; i++)
+        print flash[i]
+
+    main_depth = depth("main")
+
+    isr_depth = 0
+    for (v in isr)
+    {
+        d = depth(v)
+        if (d > isr_depth)
+        {
+            isr_depth = d
+            isr_name = v
+        }
+    }
+
+    print ""
+    print "Stack, worst case: " main_depth + isr_depth " bytes"
+    print "  main: " main_depth "  " chain("main")
+    if (isr_name != "")
+        print "  ISR:  " isr_depth "  " chain(isr_name)
+
+    for (f in recursive)
+        print "  recursion through " f ", one pass counted"
+    for (f in unknown)
+        if (f == "__indirect_call")
+            print "  calls through pointers not followed"
+        else
+            print "  no stack data for " f " (library), not counted"
+
+    if (RAM != "")
+    {
+        print ""
+        print "SRAM headroom: " RAM - sram_used - main_depth - isr_depth " of " RAM " bytes"
+    }
+}